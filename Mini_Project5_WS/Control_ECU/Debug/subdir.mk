@@ -5,30 +5,48 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../buzzer.c \
+../crc.c \
+../credential_store.c \
 ../dcmotor.c \
 ../external_eeprom.c \
 ../gpio.c \
 ../main.c \
+../protocol.c \
+../scheduler.c \
+../swtimer.c \
+../systime.c \
 ../timer0.c \
 ../twi.c \
 ../uart.c 
 
 C_DEPS += \
 ./buzzer.d \
+./crc.d \
+./credential_store.d \
 ./dcmotor.d \
 ./external_eeprom.d \
 ./gpio.d \
 ./main.d \
+./protocol.d \
+./scheduler.d \
+./swtimer.d \
+./systime.d \
 ./timer0.d \
 ./twi.d \
 ./uart.d 
 
 OBJS += \
 ./buzzer.o \
+./crc.o \
+./credential_store.o \
 ./dcmotor.o \
 ./external_eeprom.o \
 ./gpio.o \
 ./main.o \
+./protocol.o \
+./scheduler.o \
+./swtimer.o \
+./systime.o \
 ./timer0.o \
 ./twi.o \
 ./uart.o 
@@ -38,7 +56,7 @@ OBJS += \
 %.o: ../%.c subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: AVR Compiler'
-	avr-gcc -Wall -g2 -gstabs -O0 -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega16 -DF_CPU=1000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
+	avr-gcc -Wall -g2 -gstabs -Os -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega16 -DF_CPU=1000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
@@ -16,15 +16,15 @@
 void Buzzer_init(void)
 {
 	/* Setting pin as output for buzzer */
-	GPIO_setupPinDirection(BUZZER_PORT_ID , BUZZER_PIN_ID, PIN_OUTPUT);
+	GPIO_SETUP_PIN_OUTPUT(BUZZER_PORT_ID , BUZZER_PIN_ID);
 }
 void Buzzer_on(void)
 {
 	/* Enabling Buzzer */
-	GPIO_writePin(BUZZER_PORT_ID , BUZZER_PIN_ID, LOGIC_HIGH);
+	GPIO_SET_PIN(BUZZER_PORT_ID , BUZZER_PIN_ID);
 }
 void Buzzer_off(void)
 {
 	/* Disabling Buzzer */
-	GPIO_writePin(BUZZER_PORT_ID , BUZZER_PIN_ID, LOGIC_LOW);
+	GPIO_CLEAR_PIN(BUZZER_PORT_ID , BUZZER_PIN_ID);
 }
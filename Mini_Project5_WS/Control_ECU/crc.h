@@ -0,0 +1,37 @@
+ /******************************************************************************
+ *
+ * Module: CRC
+ *
+ * File Name: crc.h
+ *
+ * Description: Header file for the CRC-8 checksum used on the link and in memory
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* CRC-8 polynomial x^8 + x^2 + x + 1 */
+#define CRC8_POLYNOMIAL     0x07
+#define CRC8_INITIAL_VALUE  0x00
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Update the CRC-8 value crc with length bytes from data and return it.
+ * Start with CRC8_INITIAL_VALUE, the function can be called on consecutive blocks.
+ */
+uint8 CRC8_update(uint8 crc, const uint8 *data, uint8 length);
+
+#endif /* CRC_H_ */
@@ -0,0 +1,310 @@
+ /******************************************************************************
+ *
+ * Module: Credential Store
+ *
+ * File Name: credential_store.c
+ *
+ * Description: Source file for the journaling password store in the external EEPROM
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#include "credential_store.h"
+#include "crc.h"
+
+/* The record must fill exactly one eeprom page */
+typedef char CredentialStore_recordSizeCheck[(sizeof(CredentialStore_Record) == EEPROM_PAGE_SIZE) ? 1 : -1];
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/*
+ * RAM copies of the newest valid record and of the record being saved, the index of the
+ * newest one is changed by the TWI interrupt only after the saved record is read back
+ */
+static CredentialStore_Record g_records[2];
+static volatile uint8 g_recordIndex = 0;
+
+/* Slot of the newest valid record and if there is one */
+static volatile uint8 g_recordSlot = CREDENTIAL_STORE_NUM_SLOTS - 1;
+static volatile boolean g_recordValid = FALSE;
+
+/* Background save: the eeprom request, the page read back and the slot it is written to */
+static EEPROM_AsyncRequest g_request;
+static CredentialStore_Record g_readBack;
+static uint8 g_saveSlot;
+
+/* Number of slots the save can still try, a slot that doesn't verify is skipped */
+static uint8 g_saveTrials;
+
+/* Callback of the running save, NULL_PTR if no save is running */
+static void (* volatile g_saveCallback)(uint8 result) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Return the eeprom adress of a slot */
+static uint16 CredentialStore_slotAdress(uint8 slot);
+
+/* Return TRUE if the record has the magic byte, a possible length and a correct CRC */
+static boolean CredentialStore_isValid(const CredentialStore_Record *record);
+
+/* Fill a record with the data, the unused bytes and the CRC */
+static void CredentialStore_build(CredentialStore_Record *record, uint16 sequence, const uint8 *data, uint8 length);
+
+/* Copy the legacy password in slot 0 if it is saved, returns TRUE if it was found */
+static boolean CredentialStore_importLegacy(void);
+
+/* Queue the page write of the record being saved in the next slot, returns ERROR if it can't */
+static uint8 CredentialStore_writeNext(void);
+
+/* Try the next slot if any is left, end the save with ERROR otherwise */
+static void CredentialStore_retry(void);
+
+/* End the save and give its result to the callback */
+static void CredentialStore_end(uint8 result);
+
+/* Callbacks of the eeprom requests, called from the TWI interrupt */
+static void CredentialStore_written(TWI_Transaction *transaction);
+static void CredentialStore_verified(TWI_Transaction *transaction);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Find the newest valid record by reading every slot once and keep it in RAM.
+ * If no slot is valid the legacy password is copied in slot 0 when there is one.
+ * Called before the scheduler starts, so the blocking eeprom functions don't delay any task.
+ * Returns TRUE if a valid record was found.
+ */
+boolean CredentialStore_init(void)
+{
+	CredentialStore_Record record;
+
+	g_recordValid = FALSE;
+	g_recordSlot = CREDENTIAL_STORE_NUM_SLOTS - 1;
+
+	/* Bounded scan: one page read per slot */
+	for(uint8 slot = 0; slot < CREDENTIAL_STORE_NUM_SLOTS; slot++)
+	{
+		if(EEPROM_readBlock(CredentialStore_slotAdress(slot), (uint8 *)&record, EEPROM_PAGE_SIZE) == ERROR)
+		{
+			continue;
+		}
+		/* The newest is the one with the greatest sequence, allowing the sequence to wrap */
+		if(CredentialStore_isValid(&record) &&
+				((!g_recordValid) || ((sint16)(record.sequence - g_records[g_recordIndex].sequence) > 0)))
+		{
+			g_records[g_recordIndex] = record;
+			g_recordSlot = slot;
+			g_recordValid = TRUE;
+		}
+	}
+	if(!g_recordValid)
+	{
+		/* A unit updated from the first versions keeps its password */
+		CredentialStore_importLegacy();
+	}
+	return g_recordValid;
+}
+
+/*
+ * Description :
+ * Return TRUE if the store holds a valid record.
+ */
+boolean CredentialStore_hasRecord(void)
+{
+	return g_recordValid;
+}
+
+/*
+ * Description :
+ * Return a pointer to the data of the newest record in RAM and save its length in length.
+ */
+const uint8 * CredentialStore_get(uint8 *length)
+{
+	const CredentialStore_Record *record = &g_records[g_recordIndex];
+
+	*length = g_recordValid ? record->length : 0;
+	return record->data;
+}
+
+/*
+ * Description :
+ * Start appending a new record holding length bytes from data in the next slot and return at once.
+ * The record is written in one page write and read back in the background before it becomes
+ * the newest record, then callback is called from the TWI interrupt with SUCCESS if the
+ * record was saved or ERROR otherwise.
+ * Returns ERROR if a save is running, the data is too long or the TWI queue is full,
+ * the callback is not called then.
+ */
+uint8 CredentialStore_saveAsync(const uint8 *data, uint8 length, void (*callback)(uint8 result))
+{
+	if((g_saveCallback != NULL_PTR) || (length > CREDENTIAL_STORE_MAX_DATA))
+	{
+		return ERROR;
+	}
+
+	CredentialStore_build(&g_records[g_recordIndex ^ 1],
+			g_recordValid ? (g_records[g_recordIndex].sequence + 1) : 0, data, length);
+
+	/* If a slot doesn't verify try the one after it */
+	g_saveSlot = g_recordSlot;
+	g_saveTrials = 2;
+	g_saveCallback = callback;
+	if(CredentialStore_writeNext() == ERROR)
+	{
+		g_saveCallback = NULL_PTR;
+		return ERROR;
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Return TRUE while a record is being saved.
+ */
+boolean CredentialStore_isSaving(void)
+{
+	return (g_saveCallback != NULL_PTR);
+}
+
+static uint16 CredentialStore_slotAdress(uint8 slot)
+{
+	return CREDENTIAL_STORE_BASE_ADRESS + ((uint16)slot * EEPROM_PAGE_SIZE);
+}
+
+static boolean CredentialStore_isValid(const CredentialStore_Record *record)
+{
+	return (record->magic == CREDENTIAL_STORE_MAGIC) &&
+			(record->length <= CREDENTIAL_STORE_MAX_DATA) &&
+			(record->crc == CRC8_update(CRC8_INITIAL_VALUE, (const uint8 *)record, EEPROM_PAGE_SIZE - 1));
+}
+
+static void CredentialStore_build(CredentialStore_Record *record, uint16 sequence, const uint8 *data, uint8 length)
+{
+	uint8 i;
+
+	record->magic = CREDENTIAL_STORE_MAGIC;
+	record->sequence = sequence;
+	record->length = length;
+	for(i = 0; i < CREDENTIAL_STORE_MAX_DATA; i++)
+	{
+		record->data[i] = (i < length) ? data[i] : 0xFF;
+	}
+	record->crc = CRC8_update(CRC8_INITIAL_VALUE, (const uint8 *)record, EEPROM_PAGE_SIZE - 1);
+}
+
+static boolean CredentialStore_importLegacy(void)
+{
+	uint8 password[CREDENTIAL_STORE_LEGACY_LENGTH];
+	uint8 erased = 0;
+	uint8 i;
+
+	if(EEPROM_readBlock(CREDENTIAL_STORE_LEGACY_ADRESS, password, CREDENTIAL_STORE_LEGACY_LENGTH) == ERROR)
+	{
+		return FALSE;
+	}
+	for(i = 0; i < CREDENTIAL_STORE_LEGACY_LENGTH; i++)
+	{
+		if(password[i] == CREDENTIAL_STORE_LEGACY_ZERO)
+		{
+			password[i] = 0;
+			erased++;
+		}
+		else if((password[i] == 0) || (password[i] > 9))
+		{
+			/* Not a saved password */
+			return FALSE;
+		}
+	}
+	/* An erased eeprom reads as all 0xFF, it can't be told from the password 00000 */
+	if(erased == CREDENTIAL_STORE_LEGACY_LENGTH)
+	{
+		return FALSE;
+	}
+
+	/*
+	 * The RAM copy is used even if slot 0 can't be written so the password still works,
+	 * the copy is tried again at the next startup then
+	 */
+	CredentialStore_build(&g_records[g_recordIndex], 0, password, CREDENTIAL_STORE_LEGACY_LENGTH);
+	g_recordSlot = 0;
+	g_recordValid = TRUE;
+	EEPROM_writeBlock(CredentialStore_slotAdress(0), (const uint8 *)&g_records[g_recordIndex], EEPROM_PAGE_SIZE);
+	return TRUE;
+}
+
+static uint8 CredentialStore_writeNext(void)
+{
+	g_saveSlot = (g_saveSlot + 1) % CREDENTIAL_STORE_NUM_SLOTS;
+	g_saveTrials--;
+
+	return EEPROM_writePageAsync(&g_request, CredentialStore_slotAdress(g_saveSlot),
+			(const uint8 *)&g_records[g_recordIndex ^ 1], EEPROM_PAGE_SIZE, CredentialStore_written);
+}
+
+static void CredentialStore_retry(void)
+{
+	if((g_saveTrials > 0) && (CredentialStore_writeNext() == SUCCESS))
+	{
+		return;
+	}
+	CredentialStore_end(ERROR);
+}
+
+static void CredentialStore_end(uint8 result)
+{
+	void (*callback)(uint8 result) = g_saveCallback;
+
+	/* A new save can be started from the callback */
+	g_saveCallback = NULL_PTR;
+	if(callback != NULL_PTR)
+	{
+		callback(result);
+	}
+}
+
+static void CredentialStore_written(TWI_Transaction *transaction)
+{
+	/* Verify pass: the read waits for the write cycle of the page by itself */
+	if((transaction->status == TWI_TRANSACTION_DONE) &&
+			(EEPROM_readBlockAsync(&g_request, CredentialStore_slotAdress(g_saveSlot),
+					(uint8 *)&g_readBack, EEPROM_PAGE_SIZE, CredentialStore_verified) == SUCCESS))
+	{
+		return;
+	}
+	CredentialStore_retry();
+}
+
+static void CredentialStore_verified(TWI_Transaction *transaction)
+{
+	const uint8 *record = (const uint8 *)&g_records[g_recordIndex ^ 1];
+	uint8 i;
+
+	if(transaction->status == TWI_TRANSACTION_DONE)
+	{
+		for(i = 0; i < EEPROM_PAGE_SIZE; i++)
+		{
+			if(record[i] != ((const uint8 *)&g_readBack)[i])
+			{
+				break;
+			}
+		}
+		if(i == EEPROM_PAGE_SIZE)
+		{
+			/* The RAM copy changes only when the eeprom holds the record */
+			g_recordSlot = g_saveSlot;
+			g_recordIndex ^= 1;
+			g_recordValid = TRUE;
+			CredentialStore_end(SUCCESS);
+			return;
+		}
+	}
+	CredentialStore_retry();
+}
@@ -0,0 +1,102 @@
+ /******************************************************************************
+ *
+ * Module: Credential Store
+ *
+ * File Name: credential_store.h
+ *
+ * Description: Header file for the journaling password store in the external EEPROM
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#ifndef CREDENTIAL_STORE_H_
+#define CREDENTIAL_STORE_H_
+
+#include "std_types.h"
+#include "external_eeprom.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/*
+ * The store is a ring of slots in a reserved eeprom region, one eeprom page per slot.
+ * Every update is appended in the slot after the newest record as one page write,
+ * so the writes are spread over all the slots and a write cut by a power loss
+ * leaves the previous record as the newest valid one.
+ */
+#define CREDENTIAL_STORE_BASE_ADRESS   0x0400
+#define CREDENTIAL_STORE_NUM_SLOTS     16
+
+/* Maximum size of the data in a record */
+#define CREDENTIAL_STORE_MAX_DATA      (EEPROM_PAGE_SIZE - 5)
+
+/* First byte of every record, an erased eeprom (0xFF) is never a record */
+#define CREDENTIAL_STORE_MAGIC         0x5A
+
+/*
+ * Password saved by the first versions of the system before the store existed: one digit
+ * per byte with the digit 0 saved as 0xFF. It is copied in slot 0 once when the store is empty.
+ */
+#define CREDENTIAL_STORE_LEGACY_ADRESS 0x0311
+#define CREDENTIAL_STORE_LEGACY_LENGTH 5
+#define CREDENTIAL_STORE_LEGACY_ZERO   0xFF
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/* Record saved in one slot, exactly one eeprom page */
+typedef struct
+{
+	uint8 magic;
+	uint16 sequence;                         /* Incremented on every update */
+	uint8 length;                            /* Number of used bytes in data */
+	uint8 data[CREDENTIAL_STORE_MAX_DATA];
+	uint8 crc;                               /* CRC-8 of all the bytes before it */
+}CredentialStore_Record;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Find the newest valid record by reading every slot once and keep it in RAM.
+ * If no slot is valid the legacy password is copied in slot 0 when there is one.
+ * It uses the blocking eeprom functions so it is called once at startup.
+ * Returns TRUE if a valid record was found.
+ */
+boolean CredentialStore_init(void);
+
+/*
+ * Description :
+ * Return TRUE if the store holds a valid record.
+ */
+boolean CredentialStore_hasRecord(void);
+
+/*
+ * Description :
+ * Return a pointer to the data of the newest record in RAM and save its length in length.
+ */
+const uint8 * CredentialStore_get(uint8 *length);
+
+/*
+ * Description :
+ * Start appending a new record holding length bytes from data in the next slot and return at once.
+ * The record is written in one page write and read back in the background before it becomes
+ * the newest record, then callback is called from the TWI interrupt with SUCCESS if the
+ * record was saved or ERROR otherwise.
+ * Returns ERROR if a save is running, the data is too long or the TWI queue is full,
+ * the callback is not called then.
+ */
+uint8 CredentialStore_saveAsync(const uint8 *data, uint8 length, void (*callback)(uint8 result));
+
+/*
+ * Description :
+ * Return TRUE while a record is being saved.
+ */
+boolean CredentialStore_isSaving(void);
+
+#endif /* CREDENTIAL_STORE_H_ */
@@ -18,39 +18,34 @@
 void DcMotor_Init(void)
 {
 	/*Setting two pins for the motor*/
-	GPIO_setupPinDirection(DCMOTOR_PORT_ID, DCMOTOR_PIN0_ID, PIN_OUTPUT);
-	GPIO_setupPinDirection(DCMOTOR_PORT_ID, DCMOTOR_PIN1_ID, PIN_OUTPUT);
+	GPIO_SETUP_PORT_DIRECTION_MASKED(DCMOTOR_PORT_ID, DCMOTOR_PINS_MASK, DCMOTOR_PINS_MASK);
 	/*stopping the motor by writing zero */
-	GPIO_writePin(DCMOTOR_PORT_ID, DCMOTOR_PIN0_ID, LOGIC_LOW);
-	GPIO_writePin(DCMOTOR_PORT_ID, DCMOTOR_PIN1_ID, LOGIC_LOW);
+	GPIO_WRITE_PORT_MASKED(DCMOTOR_PORT_ID, DCMOTOR_PINS_MASK, 0);
 
 }
 /* Description:
   * Control the DC Motor direction using L293D H-bridge.
+  * Both pins are changed in one write so the H-bridge never sees a middle state.
   */
 void DcMotor_Rotate(DcMotor_State state)
 {
 	if(state == STOP)
 	{
 		/*stopping the motor by writing zero */
-		GPIO_writePin(DCMOTOR_PORT_ID, DCMOTOR_PIN0_ID, LOGIC_LOW);
-		GPIO_writePin(DCMOTOR_PORT_ID, DCMOTOR_PIN1_ID, LOGIC_LOW);
+		GPIO_WRITE_PORT_MASKED(DCMOTOR_PORT_ID, DCMOTOR_PINS_MASK, 0);
 
 	}
 	else if( state == A_CW)
 	{
 		// Rotate the motor --> anti-clock wise
-		GPIO_writePin(DCMOTOR_PORT_ID, DCMOTOR_PIN0_ID, LOGIC_LOW);
-		GPIO_writePin(DCMOTOR_PORT_ID, DCMOTOR_PIN1_ID, LOGIC_HIGH);
+		GPIO_WRITE_PORT_MASKED(DCMOTOR_PORT_ID, DCMOTOR_PINS_MASK, (1<<DCMOTOR_PIN1_ID));
 
 	}
 	else if(state == CW)
 	{
 		// Rotate the motor --> clock wise
-		GPIO_writePin(DCMOTOR_PORT_ID, DCMOTOR_PIN0_ID, LOGIC_HIGH);
-		GPIO_writePin(DCMOTOR_PORT_ID, DCMOTOR_PIN1_ID, LOGIC_LOW);
+		GPIO_WRITE_PORT_MASKED(DCMOTOR_PORT_ID, DCMOTOR_PINS_MASK, (1<<DCMOTOR_PIN0_ID));
 
 	}
 
 }
-
@@ -24,6 +24,9 @@
 #define DCMOTOR_PIN0_ID                PIN6_ID
 #define DCMOTOR_PIN1_ID                PIN7_ID
 
+/* Both motor pins, written together */
+#define DCMOTOR_PINS_MASK              ((1<<DCMOTOR_PIN0_ID) | (1<<DCMOTOR_PIN1_ID))
+
 /*Enum for the motor states of operation*/
 typedef enum DcMotor_State {STOP , CW , A_CW} DcMotor_State;
 
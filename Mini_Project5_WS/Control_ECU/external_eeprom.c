@@ -11,30 +11,49 @@
  *******************************************************************************/
 #include "external_eeprom.h"
 #include "twi.h"
+#include "common_macros.h"
+#include <avr/io.h>
+
+/*
+ * Description :
+ * End the transfer after a failed step so the bus is released for the next access,
+ * without the Stop Bit the next Start Bit is a repeated start and every access fails
+ */
+static uint8 EEPROM_abort(void)
+{
+    /* Send the Stop Bit and wait for it to be sent */
+    TWI_stop();
+    while (BIT_IS_SET(TWCR,TWSTO));
+
+    return ERROR;
+}
 
 uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data)
 {
+    /* The blocking access can't share the bus with the asynchronous transactions */
+    if (TWI_isBusy())
+        return ERROR;
 
 	/* Send the Start Bit */
     TWI_start();
     if (TWI_getStatus() != TWI_START)
-        return ERROR;
+        return EEPROM_abort();
 		
     /* Send the device address, we need to get A8 A9 A10 address bits from the
      * memory location address and R/W=0 (write) */
     TWI_writeByte((uint8)(0xA0 | ((u16addr & 0x0700)>>7)));
     if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
-        return ERROR; 
+        return EEPROM_abort(); 
 		 
     /* Send the required memory location address */
     TWI_writeByte((uint8)(u16addr));
     if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
+        return EEPROM_abort();
 		
     /* write byte to eeprom */
     TWI_writeByte(u8data);
     if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
+        return EEPROM_abort();
 
     /* Send the Stop Bit */
     TWI_stop();
@@ -44,40 +63,243 @@ uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data)
 
 uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data)
 {
+    /* The blocking access can't share the bus with the asynchronous transactions */
+    if (TWI_isBusy())
+        return ERROR;
+
 	/* Send the Start Bit */
     TWI_start();
     if (TWI_getStatus() != TWI_START)
-        return ERROR;
+        return EEPROM_abort();
 		
     /* Send the device address, we need to get A8 A9 A10 address bits from the
      * memory location address and R/W=0 (write) */
     TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7)));
     if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
-        return ERROR;
+        return EEPROM_abort();
 		
     /* Send the required memory location address */
     TWI_writeByte((uint8)(u16addr));
     if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
+        return EEPROM_abort();
 		
     /* Send the Repeated Start Bit */
     TWI_start();
     if (TWI_getStatus() != TWI_REP_START)
-        return ERROR;
+        return EEPROM_abort();
 		
     /* Send the device address, we need to get A8 A9 A10 address bits from the
      * memory location address and R/W=1 (Read) */
     TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7) | 1));
     if (TWI_getStatus() != TWI_MT_SLA_R_ACK)
-        return ERROR;
+        return EEPROM_abort();
 
     /* Read Byte from Memory without send ACK */
     *u8data = TWI_readByteWithNACK();
     if (TWI_getStatus() != TWI_MR_DATA_NACK)
+        return EEPROM_abort();
+
+    /* Send the Stop Bit */
+    TWI_stop();
+
+    return SUCCESS;
+}
+
+uint8 EEPROM_readBlock(uint16 u16addr, uint8 *u8data, uint16 u16length)
+{
+    uint16 i;
+
+    /* The blocking access can't share the bus with the asynchronous transactions */
+    if (TWI_isBusy())
         return ERROR;
 
+    if (u16length == 0)
+        return SUCCESS;
+
+	/* Send the Start Bit */
+    TWI_start();
+    if (TWI_getStatus() != TWI_START)
+        return EEPROM_abort();
+
+    /* Send the device address, we need to get A8 A9 A10 address bits from the
+     * memory location address and R/W=0 (write) */
+    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7)));
+    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
+        return EEPROM_abort();
+
+    /* Send the required memory location address */
+    TWI_writeByte((uint8)(u16addr));
+    if (TWI_getStatus() != TWI_MT_DATA_ACK)
+        return EEPROM_abort();
+
+    /* Send the Repeated Start Bit */
+    TWI_start();
+    if (TWI_getStatus() != TWI_REP_START)
+        return EEPROM_abort();
+
+    /* Send the device address, we need to get A8 A9 A10 address bits from the
+     * memory location address and R/W=1 (Read) */
+    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7) | 1));
+    if (TWI_getStatus() != TWI_MT_SLA_R_ACK)
+        return EEPROM_abort();
+
+    /* Sequential read: ACK every byte so the memory sends the next one */
+    for (i = 0; i < (u16length - 1); i++)
+    {
+        u8data[i] = TWI_readByteWithACK();
+        if (TWI_getStatus() != TWI_MR_DATA_ACK)
+            return EEPROM_abort();
+    }
+
+    /* Read the last Byte without send ACK to end the read */
+    u8data[i] = TWI_readByteWithNACK();
+    if (TWI_getStatus() != TWI_MR_DATA_NACK)
+        return EEPROM_abort();
+
     /* Send the Stop Bit */
     TWI_stop();
 
     return SUCCESS;
 }
+
+uint8 EEPROM_writeBlock(uint16 u16addr, const uint8 *u8data, uint16 u16length)
+{
+    uint16 page_length;
+    uint16 i;
+
+    /* The blocking access can't share the bus with the asynchronous transactions */
+    if (TWI_isBusy())
+        return ERROR;
+
+    while (u16length > 0)
+    {
+        /* Write till the end of the current page only */
+        page_length = EEPROM_PAGE_SIZE - (u16addr % EEPROM_PAGE_SIZE);
+        if (page_length > u16length)
+            page_length = u16length;
+
+        /* Send the Start Bit */
+        TWI_start();
+        if (TWI_getStatus() != TWI_START)
+            return EEPROM_abort();
+
+        /* Send the device address, we need to get A8 A9 A10 address bits from the
+         * memory location address and R/W=0 (write) */
+        TWI_writeByte((uint8)(0xA0 | ((u16addr & 0x0700)>>7)));
+        if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
+            return EEPROM_abort();
+
+        /* Send the required memory location address */
+        TWI_writeByte((uint8)(u16addr));
+        if (TWI_getStatus() != TWI_MT_DATA_ACK)
+            return EEPROM_abort();
+
+        /* write the page bytes to eeprom, it increments the address inside the page */
+        for (i = 0; i < page_length; i++)
+        {
+            TWI_writeByte(u8data[i]);
+            if (TWI_getStatus() != TWI_MT_DATA_ACK)
+                return EEPROM_abort();
+        }
+
+        /* Send the Stop Bit to start the write cycle */
+        TWI_stop();
+
+        /* Wait for the write cycle to end before the next page */
+        if (EEPROM_waitReady(u16addr) == ERROR)
+            return ERROR;
+
+        u16addr += page_length;
+        u8data += page_length;
+        u16length -= page_length;
+    }
+
+    return SUCCESS;
+}
+
+uint8 EEPROM_waitReady(uint16 u16addr)
+{
+    uint16 tries;
+
+    /* The blocking access can't share the bus with the asynchronous transactions */
+    if (TWI_isBusy())
+        return ERROR;
+
+    for (tries = 0; tries < EEPROM_ACK_POLL_MAX_TRIES; tries++)
+    {
+        /* Wait for the previous Stop Bit to be sent */
+        while (BIT_IS_SET(TWCR,TWSTO));
+
+        /* Send the Start Bit */
+        TWI_start();
+        if (TWI_getStatus() != TWI_START)
+            return EEPROM_abort();
+
+        /* The memory doesn't ACK its address during the write cycle */
+        TWI_writeByte((uint8)(0xA0 | ((u16addr & 0x0700)>>7)));
+        if (TWI_getStatus() == TWI_MT_SLA_W_ACK)
+        {
+            TWI_stop();
+            return SUCCESS;
+        }
+
+        /* Send the Stop Bit and try again */
+        TWI_stop();
+    }
+
+    return ERROR;
+}
+
+uint8 EEPROM_readBlockAsync(EEPROM_AsyncRequest *request, uint16 u16addr, uint8 *u8data, uint8 u8length,
+		void (*callback)(TWI_Transaction *transaction))
+{
+    /* Write the memory location address then read the data after a repeated start */
+    request->buffer[0] = (uint8)(u16addr);
+
+    /* The device address holds A8 A9 A10 address bits from the memory location address */
+    request->transaction.slave_address = (uint8)(0x50 | ((u16addr & 0x0700)>>8));
+    request->transaction.write_data = request->buffer;
+    request->transaction.write_length = 1;
+    request->transaction.read_data = u8data;
+    request->transaction.read_length = u8length;
+    /* Wait for a write cycle that may still be running */
+    request->transaction.nack_retries = EEPROM_ACK_POLL_MAX_TRIES;
+    request->transaction.callback = callback;
+
+    if (TWI_submit(&request->transaction) == FALSE)
+        return ERROR;
+
+    return SUCCESS;
+}
+
+uint8 EEPROM_writePageAsync(EEPROM_AsyncRequest *request, uint16 u16addr, const uint8 *u8data, uint8 u8length,
+		void (*callback)(TWI_Transaction *transaction))
+{
+    uint8 i;
+
+    /* A page write can't cross the page boundary */
+    if ((u8length == 0) || (((u16addr % EEPROM_PAGE_SIZE) + u8length) > EEPROM_PAGE_SIZE))
+        return ERROR;
+
+    /* The memory location address followed by the data */
+    request->buffer[0] = (uint8)(u16addr);
+    for (i = 0; i < u8length; i++)
+    {
+        request->buffer[1 + i] = u8data[i];
+    }
+
+    /* The device address holds A8 A9 A10 address bits from the memory location address */
+    request->transaction.slave_address = (uint8)(0x50 | ((u16addr & 0x0700)>>8));
+    request->transaction.write_data = request->buffer;
+    request->transaction.write_length = 1 + u8length;
+    request->transaction.read_data = NULL_PTR;
+    request->transaction.read_length = 0;
+    /* Wait for a write cycle that may still be running */
+    request->transaction.nack_retries = EEPROM_ACK_POLL_MAX_TRIES;
+    request->transaction.callback = callback;
+
+    if (TWI_submit(&request->transaction) == FALSE)
+        return ERROR;
+
+    return SUCCESS;
+}
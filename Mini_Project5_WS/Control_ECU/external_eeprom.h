@@ -15,6 +15,7 @@
 #define EXTERNAL_EEPROM_H_
 
 #include "std_types.h"
+#include "twi.h"
 
 /*******************************************************************************
  *                      Preprocessor Macros                                    *
@@ -22,11 +23,82 @@
 #define ERROR 0
 #define SUCCESS 1
 
+/* The memory writes at most one page of EEPROM_PAGE_SIZE bytes in one write cycle */
+#define EEPROM_PAGE_SIZE            16
+
+/*
+ * Maximum number of times the device address is sent while waiting for a write cycle
+ * to end, one try takes about 30 us at 400 kbps so this covers more than the 5 ms write cycle
+ */
+#define EEPROM_ACK_POLL_MAX_TRIES   1000
+
+/*
+ * The blocking functions below return ERROR without using the bus while an asynchronous
+ * transaction is running or waiting (TWI_isBusy), they don't wait for it
+ */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/*
+ * Asynchronous request, holds the TWI transaction and the memory location address
+ * followed by the data for writes. Must stay valid until the callback is called.
+ */
+typedef struct
+{
+	TWI_Transaction transaction;
+	uint8 buffer[1 + EEPROM_PAGE_SIZE];
+}EEPROM_AsyncRequest;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 uint8 EEPROM_writeByte(uint16 u16addr,uint8 u8data);
 uint8 EEPROM_readByte(uint16 u16addr,uint8 *u8data);
+
+/*
+ * Description :
+ * Read u16length bytes starting from u16addr in one I2C transaction
+ * using the sequential read of the memory.
+ */
+uint8 EEPROM_readBlock(uint16 u16addr,uint8 *u8data,uint16 u16length);
+
+/*
+ * Description :
+ * Write u16length bytes starting from u16addr.
+ * The data is split on page boundaries and each page is written in one page write,
+ * the function returns after the memory acknowledges the end of the last write cycle.
+ */
+uint8 EEPROM_writeBlock(uint16 u16addr,const uint8 *u8data,uint16 u16length);
+
+/*
+ * Description :
+ * Wait for the memory to end its internal write cycle by polling for its ACK.
+ * Returns ERROR if it doesn't answer within EEPROM_ACK_POLL_MAX_TRIES.
+ */
+uint8 EEPROM_waitReady(uint16 u16addr);
+
+/*
+ * Description :
+ * Start reading u8length bytes starting from u16addr in the background and return at once.
+ * The callback is called from the TWI interrupt when the read ends,
+ * request->transaction.status tells if it was done or failed.
+ * Returns ERROR if the TWI queue is full.
+ */
+uint8 EEPROM_readBlockAsync(EEPROM_AsyncRequest *request, uint16 u16addr, uint8 *u8data, uint8 u8length,
+		void (*callback)(TWI_Transaction *transaction));
+
+/*
+ * Description :
+ * Start writing u8length bytes starting from u16addr in the background and return at once.
+ * The bytes must be inside one page, they are copied in the request.
+ * The memory is busy for its write cycle after the callback, the next asynchronous
+ * transaction waits for it by itself but the blocking functions need EEPROM_waitReady first.
+ * Returns ERROR if the bytes cross a page or the TWI queue is full.
+ */
+uint8 EEPROM_writePageAsync(EEPROM_AsyncRequest *request, uint16 u16addr, const uint8 *u8data, uint8 u8length,
+		void (*callback)(TWI_Transaction *transaction));
  
 #endif /* EXTERNAL_EEPROM_H_ */
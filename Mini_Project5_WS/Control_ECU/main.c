@@ -12,35 +12,109 @@
 
 #include "dcmotor.h"
 #include "external_eeprom.h"
-#include "timer0.h"
+#include "credential_store.h"
+#include "systime.h"
+#include "swtimer.h"
+#include "scheduler.h"
 #include "twi.h"
 #include "buzzer.h"
 #include "uart.h"
-#include <util/delay.h> /* For the delay functions */
+#include "protocol.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
 
 /*******************************************************************************
  *                      Preprocessor Macros                                    *
  *******************************************************************************/
 
-/* Define Commands in Communication between the two Controllers*/
-#define MISMATCH          0x00  /* Means the password sent doesn't match the one saved in eeprom */
-#define MATCH             0x01  /* Means the password sent matchs the one saved in eeprom */
-#define OPENDOOR          0x02  /* Means the user wants to open the door */
-#define CHANGEPASS        0x03  /* Means the usaer wants to change the saved password */
-#define TRIGGER           0x04  /* Means trigger the buzzer alarm */
-#define READY             0x05  /* Means ready to start the timer to count used for sync */
+/* Events of the link task */
+#define LINK_EVENT_RX          0x01  /* Bytes received or the frame timeout passed */
+#define LINK_EVENT_SAVED       0x02  /* The credential store ended saving a password */
 
-/* Define Time for timer to count by interrupts */
-#define SEC_15            457   /* The number of interrupts needed to count 15 sec */
-#define SEC_18            548   /* The number of interrupts needed to count 15 + 3 sec */
-#define SEC_33            1005  /* The number of interrupts needed to count 15 + 3 + 15 sec */
-#define MINUTE            1828  /* The number of interrupts needed to count 1 min */
+/* Events of the door task */
+#define DOOR_EVENT_START       0x01  /* Open request with the right password */
+#define DOOR_EVENT_STEP        0x02  /* The time of the door step passed */
+#define DOOR_EVENT_STOP        0x04  /* Stop request, the motor is already stopped */
+
+/* Events of the alarm task */
+#define ALARM_EVENT_START      0x01  /* 3 wrong passwords */
+#define ALARM_EVENT_STOP       0x02  /* The alarm time passed */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/* Steps of setting the first password of the system */
+typedef enum
+{
+	SETUP_SAVE , SETUP_CONFIRM , SETUP_DONE
+}Setup_Step;
+
+/* States of the door cycle */
+typedef enum
+{
+	DOOR_CLOSED , DOOR_UNLOCKING , DOOR_OPEN , DOOR_LOCKING , DOOR_STOPPED
+}Door_State;
 
 /*******************************************************************************
  *                           Global Variables                                  *
  *******************************************************************************/
-/* Globel variable to save the number of overflow interrupts of timer0 */
-uint16 g_timer0Ticks = 0;
+
+/* Tasks of the system, each one handles its events and returns without waiting */
+static Scheduler_Task g_linkTask;
+static Scheduler_Task g_doorTask;
+static Scheduler_Task g_alarmTask;
+
+/*
+ * Step of setting the first password, the requests are handled after it is done.
+ * It is done at startup if the credential store has a record because the first
+ * password is saved only after it is confirmed.
+ */
+static Setup_Step g_setupStep = SETUP_SAVE;
+
+/* First password kept until it is confirmed */
+static uint8 g_setupPassword[PASSWORD_LENGTH];
+
+/* Timer to poll the link again when a frame stops in the middle */
+static SwTimer g_linkTimer;
+
+/*
+ * A password is being saved in the background, its verdict is sent when the save ends
+ * with the result given by the credential store
+ */
+static boolean g_savePending = FALSE;
+static volatile uint8 g_saveResult = ERROR;
+
+/* State of the door and the time its cycle started */
+static Door_State g_doorState = DOOR_CLOSED;
+static uint32 g_doorStartTime;
+
+/* Time of the cycle done before the door was stopped */
+static uint32 g_doorStopOffset = 0;
+
+/* Time of the cycle the next open request starts from, sent to the HMI_ECU with the verdict */
+static uint32 g_doorResumeTime = 0;
+
+/*
+ * Set by the Rx interrupt with the stop request, no motor write of the door task can turn
+ * the motor on again until the next open request clears it
+ */
+static volatile boolean g_doorStopLatched = FALSE;
+
+/* Timer of the door steps, every step ends at a time from the start so the steps don't add errors */
+static SwTimer g_doorTimer;
+
+/* Timer of the alarm, runs together with the door cycle if both are requested */
+static SwTimer g_alarmTimer;
+
+/*
+ * Password streamed by the HMI_ECU digit by digit while it is typed: the saved password taken
+ * at the first digit, the number of digits compared and the differences found, kept together
+ * so a wrong digit is only known when the request arrives
+ */
+static const uint8 * g_streamSaved;
+static uint8 g_streamCount = 0;
+static uint8 g_streamDiff = 1;
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -48,191 +122,561 @@ uint16 g_timer0Ticks = 0;
 
 /*
  * Description:
- * Function to be set as the Callback Function for Timer0
- * It counts the number of overflow interrupts
- * Uses a global variable to save the count
+ * Function to compare two passwords
+ * All the digits are compared so the time doesn't tell the position of a wrong digit
+ * Returns 1 if match 0 if mismatch
  */
-void Timer0_interruptCounter(void)
+uint8 Compare_Password(const uint8 * a_password, const uint8 * a_expected)
 {
-	/* Increment on every interrupt */
-	g_timer0Ticks++;
+	/* Bits that differ in any digit */
+	uint8 difference = 0;
+
+	/* Loop to check the password of 5 numbers */
+	for(uint8 i = 0; i < PASSWORD_LENGTH; i++ )
+	{
+		difference |= a_password[i] ^ a_expected[i];
+	}
+	/* Return 1 means match and 0 means mismatch of passwords */
+	return (difference == 0) ? MATCH : MISMATCH;
 }
 
 /*
  * Description:
- * Function to save the password for the system in eeprom
+ * Function to check that the password given match the one saved in eeprom for the system
  * It takes the password array of the system as argument
- * Takes the adress in the eeprom as argument
+ * Compares it to the RAM copy of the newest password record so no eeprom access is needed
+ * Returns 1 if match 0 if mismatch
  */
-void Save_Password(uint8 * a_password , uint16 a_adress)
+uint8 Check_Password(const uint8 * a_password)
 {
+	/* Length of the saved password */
+	uint8 length;
+	const uint8 * saved_password = CredentialStore_get(&length);
 
-	/* Loop to save the password of 5 numbers in eeprom */
-	for(uint8 i = 0; i < 5; i++ )
+	if(length != PASSWORD_LENGTH)
 	{
-		/* Writing in the eeprom by taking the 1st adress then incrementing it in the loop */
-		EEPROM_writeByte(a_adress + i, a_password[i]);
-		_delay_ms(10);
+		/* No password saved so it is a mismatch */
+		return MISMATCH;
 	}
+	return Compare_Password(a_password, saved_password);
 }
 
 /*
  * Description:
- * Function to check that the password given match the one saved in eeprom for the system
- * It takes the password array of the system as argument
- * Takes the adress in the eeprom as argument
- * Reads the value of each byte int the memory and compare it to the password
- * Returns 1 if match 0 if mismatch
+ * Function to compare a password digit streamed by the HMI_ECU as soon as it arrives
+ * The first digit takes the saved password from the RAM copy of the store, a digit out
+ * of order or after the last one makes the password wrong. Nothing is sent back so the
+ * position of a wrong digit is not told.
  */
-uint8 Check_Password(uint8 * a_password , uint16 a_adress)
+void Stream_Digit(const uint8 * a_payload)
 {
-	/* Variable to return the compare result
-	 * Variable to save byte read from eeprom */
-	uint8 password_status = 0 , byte_val;
-	/* Loop to check the password of 5 numbers in eeprom */
-	for(uint8 i = 0; i < 5; i++ )
+	uint8 length;
+
+	if(a_payload[0] == 0)
 	{
-		/* Reading from the eeprom by taking the 1st adress then incrementing it in the loop */
-		EEPROM_readByte(a_adress + i, &byte_val);
-		_delay_ms(10);
-		if( a_password[i] != byte_val )
-		{
-			/* Return 0 means mismatch of passwords */
-			password_status = MISMATCH;
-			break;
-		}
-		/* Else: return 1 means match */
-		password_status = MATCH;
+		/* New password, taking the saved one for the coming digits */
+		g_streamSaved = CredentialStore_get(&length);
+		g_streamCount = 0;
+		g_streamDiff = (length != PASSWORD_LENGTH);
+	}
+	if((a_payload[0] != g_streamCount) || (g_streamCount >= PASSWORD_LENGTH))
+	{
+		g_streamDiff = 1;
+		return;
 	}
+	g_streamDiff |= a_payload[1] ^ g_streamSaved[g_streamCount];
+	g_streamCount++;
+}
+
+/*
+ * Description:
+ * Function to take the result of the streamed password, ready once the last digit arrived
+ * The stream is used by one request only
+ * Returns 1 if match 0 if mismatch
+ */
+uint8 Stream_Verdict(void)
+{
+	uint8 password_status = ((g_streamCount == PASSWORD_LENGTH) && (g_streamDiff == 0)) ? MATCH : MISMATCH;
+
+	g_streamCount = 0;
+	g_streamDiff = 1;
 	return password_status;
 }
 
-/*******************************************************************************
- *                                Main Function                                *
- *******************************************************************************/
+/*
+ * Description:
+ * Callback of the credential store when the save of a password ends, called from the TWI interrupt
+ */
+void Link_notifySaved(uint8 a_result)
+{
+	g_saveResult = a_result;
+	Scheduler_setEvents(&g_linkTask, LINK_EVENT_SAVED);
+}
 
-void main(void)
+/*
+ * Description:
+ * Function to save the password for the system in eeprom
+ * It takes the password array of the system as argument
+ * The password is appended as a new record of the credential store in one page write
+ * done in the background, the link task sends the verdict when it ends
+ * Returns SUCCESS if the save started, ERROR otherwise
+ */
+uint8 Save_Password(const uint8 * a_password)
 {
-	/* Struct to configer UART with Baud rate = 9600 bps and one stop bit*/
-	Uart_ConfigType Config_Uart = { 9600 , ONE_STOP_BIT };
+	if(CredentialStore_saveAsync(a_password, PASSWORD_LENGTH, Link_notifySaved) == ERROR)
+	{
+		return ERROR;
+	}
+	g_savePending = TRUE;
+	return SUCCESS;
+}
 
-	/* Struct ti configer Timer 0 in overflow mode with prescaler 1024 and initial value = 0*/
-	Timer0_ConfigType Config_Timer0 = {NORMAL , F_CPU_1024 , 0  , 255};
+/*
+ * Description:
+ * Function to send the verdict of a request that saved a password once the save ended
+ * The eeprom holds the new password if the verdict is a match
+ */
+void Reply_Saved(void)
+{
+	uint8 password_check_status = (g_saveResult == SUCCESS) ? MATCH : MISMATCH;
 
-	/* Struct to configer I2C with bit rate = 400 kbps and the adress of the Microcontroller is 0x01*/
-	I2c_ConfigType  Config_I2c = { FAST_MODE , 0x01};
+	g_savePending = FALSE;
+	PROTOCOL_sendFrame(VERDICT, &password_check_status, 1);
+	if(g_setupStep == SETUP_CONFIRM)
+	{
+		/* The first password is set once it is saved, it must be set again otherwise */
+		g_setupStep = (password_check_status == MATCH) ? SETUP_DONE : SETUP_SAVE;
+	}
+}
 
-	/* Initializing Drivers */
-	UART_init(&Config_Uart);     /* Initializing UART to communicate with HMI_ECU */
-	Timer0_init(&Config_Timer0); /* Initializing Timer0 to count time for motor */
-	TWI_init(&Config_I2c);       /* Initializing I2C to communicate with eeprom */
-	DcMotor_Init();              /* Initializing DC motor to open and close door */
-	Buzzer_init();               /* Initializing buzzer for the alarm */
-	/* Setting Callback Function for Timer 0 */
-	Timer0_setCallBack(Timer0_interruptCounter, NORMAL);
-	/*
-	 * Password of 5 numbers each in a byte
-	 * Array of bytes to the password of 5 numbers
-	 * Char for UART sending string
-	 */
-	uint8 password[6] = {0};
-	uint8 option; /* Variable to save Received request */
-	uint8 password_check_status = MISMATCH; /* Initially mismatch to enter the loop 1st time*/
-
-	/*
-	 * In case of mismatch of password the password
-	 * must be cleared and new password to be saved
-	 * To exit the loop the two passwords must be exact
-	 */
-	while( password_check_status == MISMATCH)
-	{
-		/* Receiving password */
-		UART_receiveString(password);
-		/* Initializing password and sending it to be saved in eeprom*/
-		Save_Password(password, 0x0311);
-		/* Receiving reenetered password */
-		UART_receiveString(password);
-		/* Checking the reenetered password */
-		password_check_status = Check_Password(password, 0x0311);
-		/* Sending password compare result to HMI_ECU */
-		UART_sendByte(password_check_status);
-	}
-
-
-	while(1)
-	{
-
-		/* Receiving requests from HMI_ECU */
-		option = UART_recieveByte();
-		if(option == OPENDOOR)
-		{
-			/* Receiving password from HMI */
-			UART_receiveString(password);
-			/* Checking password with the saved in eeprom */
-			password_check_status = Check_Password(password, 0x0311);
-			/* sending results to HMI */
-			if( password_check_status == MISMATCH)
+/*
+ * Description:
+ * Function to send the provisioning status to the HMI_ECU
+ * The system is provisioned when the first password was confirmed and saved
+ */
+void Reply_Status(void)
+{
+	uint8 provisioning_status = (g_setupStep == SETUP_DONE) ? PROVISIONED : NOT_PROVISIONED;
+
+	PROTOCOL_sendFrame(STATUS, &provisioning_status, 1);
+}
+
+/*
+ * Description:
+ * Callbacks of the UART and the software timers, they only set the events of the tasks
+ */
+void Link_notify(void)
+{
+	Scheduler_setEvents(&g_linkTask, LINK_EVENT_RX);
+}
+
+void Door_notifyStep(void)
+{
+	Scheduler_setEvents(&g_doorTask, DOOR_EVENT_STEP);
+}
+
+void Alarm_notifyStop(void)
+{
+	Scheduler_setEvents(&g_alarmTask, ALARM_EVENT_STOP);
+}
+
+/*
+ * Description:
+ * Callback of the UART Rx interrupt with every received byte
+ * The stop request is handled here so the motor stops at once even if a task is running,
+ * the door task is told after. The bytes are handled by the link task as usual.
+ */
+void Link_receive(uint8 a_data)
+{
+	if(PROTOCOL_detectCommand(a_data, DOOR_STOP))
+	{
+		g_doorStopLatched = TRUE;
+		DcMotor_Rotate(STOP);
+		Scheduler_setEvents(&g_doorTask, DOOR_EVENT_STOP);
+	}
+	Scheduler_setEvents(&g_linkTask, LINK_EVENT_RX);
+}
+
+/*
+ * Description:
+ * Function to drive the door motor from the door task
+ * The stop latch is checked with the interrupts disabled so a stop received in the
+ * Rx interrupt while a step was running is never undone by the step
+ */
+void Door_rotate(DcMotor_State a_state)
+{
+	uint8 sreg = SREG;
+
+	cli();
+	DcMotor_Rotate(g_doorStopLatched ? STOP : a_state);
+	SREG = sreg;
+}
+
+/*
+ * Description:
+ * Function to go to the next door state and arm the timer for the end of its step
+ * The end time is from the start of the cycle
+ */
+void Door_enter(Door_State a_state, uint32 a_step_end_ms)
+{
+	g_doorState = a_state;
+	SwTimer_startAt(&g_doorTimer, SysTime_deadline(g_doorStartTime, a_step_end_ms), 0, Door_notifyStep);
+}
+
+/*
+ * Description:
+ * Function to get the time of the door cycle an open request starts from, 0 for a closed door
+ * A door stopped while unlocking or open goes on from where it was stopped. A door that
+ * was locking is opened again from where it is: the motor runs at the same speed both
+ * ways so it was unlocked again for the time it was locking.
+ */
+uint32 Door_resumeTime(void)
+{
+	uint32 elapsed;
+
+	if(g_doorState == DOOR_CLOSED)
+	{
+		return 0;
+	}
+	elapsed = (g_doorState == DOOR_STOPPED) ? g_doorStopOffset : (SysTime_millis() - g_doorStartTime);
+	if(elapsed >= (DOOR_UNLOCKING_MS + DOOR_OPEN_MS))
+	{
+		elapsed -= (DOOR_UNLOCKING_MS + DOOR_OPEN_MS);
+		elapsed = (elapsed < DOOR_UNLOCKING_MS) ? (DOOR_UNLOCKING_MS - elapsed) : 0;
+	}
+	return elapsed;
+}
+
+/*
+ * Description:
+ * Function to start the door cycle a_elapsed_ms after its beginning, in the unlocking
+ * step or the open step, a_elapsed_ms is from Door_resumeTime
+ */
+void Door_start(uint32 a_elapsed_ms)
+{
+	g_doorStartTime = SysTime_millis() - a_elapsed_ms;
+
+	if(a_elapsed_ms < DOOR_UNLOCKING_MS)
+	{
+		/* Rotating DC motor for 15 sec CW to open*/
+		Door_rotate(CW);
+		Door_enter(DOOR_UNLOCKING, DOOR_UNLOCKING_MS);
+	}
+	else
+	{
+		/* Door stays open for 3 sec */
+		Door_rotate(STOP);
+		Door_enter(DOOR_OPEN, DOOR_UNLOCKING_MS + DOOR_OPEN_MS);
+	}
+}
+
+/*
+ * Description:
+ * Function to send the verdict of an open request, with a match the phase and the time
+ * of the door cycle it starts from so the HMI_ECU shows the same steps
+ */
+void Reply_DoorVerdict(uint8 a_status)
+{
+	uint8 verdict[VERDICT_DOOR_LENGTH];
+
+	if(a_status != MATCH)
+	{
+		PROTOCOL_sendFrame(VERDICT, &a_status, 1);
+		return;
+	}
+	g_doorResumeTime = Door_resumeTime();
+	verdict[0] = MATCH;
+	verdict[1] = (g_doorResumeTime < DOOR_UNLOCKING_MS) ? DOOR_PHASE_UNLOCKING : DOOR_PHASE_OPEN;
+	verdict[2] = (uint8)(g_doorResumeTime >> 8);
+	verdict[3] = (uint8)g_doorResumeTime;
+	PROTOCOL_sendFrame(VERDICT, verdict, VERDICT_DOOR_LENGTH);
+}
+
+/*
+ * Description:
+ * Function to handle a request from the HMI_ECU
+ * Timed actions are given to their tasks so the function returns at once
+ */
+void Handle_Request(const Protocol_Frame * a_frame)
+{
+	uint8 password_check_status;
+	const uint8 * new_password;
+
+	if(a_frame->command == GET_STATUS)
+	{
+		/* The HMI_ECU started, a setting of the first password that was cut starts again */
+		if(g_setupStep == SETUP_CONFIRM)
+		{
+			g_setupStep = SETUP_SAVE;
+		}
+		Reply_Status();
+	}
+	else if(g_setupStep != SETUP_DONE)
+	{
+		/* Setting the first password, only passwords are accepted */
+		if(a_frame->command != PASSWORD)
+		{
+			return;
+		}
+		if(g_setupStep == SETUP_SAVE)
+		{
+			/* Keeping the password until it is confirmed, the eeprom holds confirmed passwords only */
+			for(uint8 i = 0; i < PASSWORD_LENGTH; i++ )
+			{
+				g_setupPassword[i] = (a_frame->length == PASSWORD_LENGTH) ? a_frame->payload[i] : 0xFF;
+			}
+			g_setupStep = SETUP_CONFIRM;
+		}
+		else
+		{
+			/* Checking the reenetered password and saving it in eeprom if it matches */
+			password_check_status = MISMATCH;
+			if(a_frame->length == PASSWORD_LENGTH)
 			{
-				/* Send to HMI that password missmatched */
-				UART_sendByte(MISMATCH);
+				password_check_status = Compare_Password(a_frame->payload, g_setupPassword);
 			}
-			else if(password_check_status == MATCH)
+			if(password_check_status == MATCH)
 			{
-				/* Sending to HMI that password matched */
-				UART_sendByte(MATCH);
-				/* Wait for HMI to be ready to start and send ready messege */
-				UART_sendByte(READY);
-				UART_recieveByte();
-				/* Initializing Timer to count the time for openning and closing the door*/
-				Timer0_init(&Config_Timer0);
-				/* Clearing ticks to start counting */
-				g_timer0Ticks = 0;
-				/* Rotating DC motor for 15 sec CW to open*/
-				DcMotor_Rotate(CW);
-				/* wait 15 sec till the door is open */
-				while(g_timer0Ticks < SEC_15);
-				/* Stopping Door for 3 sec */
-				DcMotor_Rotate(STOP);
-				while( g_timer0Ticks < SEC_18);
-				/* Start count for 15 sec and Closing the Door*/
-				DcMotor_Rotate(A_CW);
-				while( g_timer0Ticks < SEC_33);
-				DcMotor_Rotate(STOP);
-				/* Stopping Timer to reset it */
-				Timer0_DeInit();
-				g_timer0Ticks = 0;
-
+				if(Save_Password(g_setupPassword) == SUCCESS)
+				{
+					/* Sending the result to HMI_ECU after the password is saved */
+					return;
+				}
+				/* The password couldn't be saved */
+				password_check_status = MISMATCH;
 			}
+			PROTOCOL_sendFrame(VERDICT, &password_check_status, 1);
+			/*
+			 * In case of mismatch of password the password
+			 * must be cleared and new password to be saved
+			 */
+			g_setupStep = (password_check_status == MATCH) ? SETUP_DONE : SETUP_SAVE;
 		}
-		else if(option == CHANGEPASS)
+	}
+	else if(a_frame->command == DIGIT)
+	{
+		if(a_frame->length == 2)
 		{
-
-			/* Taking enterd password */
-			UART_receiveString(password);
-			/* Checking reentered password and responding to HMI */
-			password_check_status = Check_Password(password, 0x0311);
-			UART_sendByte(password_check_status);
-			if(password_check_status == MATCH)
+			Stream_Digit(a_frame->payload);
+		}
+	}
+	else if(a_frame->command == OPENDOOR)
+	{
+		if(a_frame->length == 0)
+		{
+			/* The password was streamed, its result is ready */
+			password_check_status = Stream_Verdict();
+		}
+		else if(a_frame->length == PASSWORD_LENGTH)
+		{
+			/* The request carries the password, checking it with the saved in eeprom */
+			password_check_status = Check_Password(a_frame->payload);
+		}
+		else
+		{
+			password_check_status = MISMATCH;
+		}
+		/* Sending results to HMI with the door phase */
+		Reply_DoorVerdict(password_check_status);
+		if(password_check_status == MATCH)
+		{
+			/* The HMI starts its countdown on the MATCH verdict so the cycle starts at once */
+			Scheduler_setEvents(&g_doorTask, DOOR_EVENT_START);
+		}
+	}
+	else if(a_frame->command == CHANGEPASS)
+	{
+		/* The request carries the old password followed by the new one, or the new one only if the old was streamed */
+		password_check_status = MISMATCH;
+		new_password = NULL_PTR;
+		if(a_frame->length == PASSWORD_LENGTH)
+		{
+			password_check_status = Stream_Verdict();
+			new_password = a_frame->payload;
+		}
+		else if(a_frame->length == (2 * PASSWORD_LENGTH))
+		{
+			password_check_status = Check_Password(a_frame->payload);
+			new_password = a_frame->payload + PASSWORD_LENGTH;
+		}
+		/* Saving the new password in eeprom if the old one matches */
+		if(password_check_status == MATCH)
+		{
+			if(Save_Password(new_password) == SUCCESS)
 			{
-				/* Taking new password from HMI */
-				UART_receiveString(password);
-				/* Saving password in eeprom */
-				Save_Password(password, 0x0311);
+				/* One reply after the new password is saved */
+				return;
 			}
+			/* The new password couldn't be saved */
+			password_check_status = MISMATCH;
+		}
+		PROTOCOL_sendFrame(VERDICT, &password_check_status, 1);
+	}
+	else if(a_frame->command == TRIGGER)
+	{
+		Scheduler_setEvents(&g_alarmTask, ALARM_EVENT_START);
+	}
+	/* Else: DOOR_STOP was already handled in the Rx interrupt when its last byte was received */
+}
+
+/*
+ * Description:
+ * Task to receive the frames from the HMI_ECU and handle the requests
+ */
+void Link_task(uint8 a_events)
+{
+	/* Frame received from HMI_ECU, the payload points inside the protocol receive buffer */
+	Protocol_Frame frame;
+	Protocol_Status status;
+
+	if(a_events & LINK_EVENT_SAVED)
+	{
+		Reply_Saved();
+	}
+	/* The requests wait in the UART while a password is saved so they are handled in order */
+	if(g_savePending)
+	{
+		return;
+	}
+
+	while((status = PROTOCOL_poll(&frame)) != PROTOCOL_FRAME_PENDING)
+	{
+		if(status == PROTOCOL_FRAME_READY)
+		{
+			Handle_Request(&frame);
+		}
+		if(g_savePending)
+		{
+			return;
+		}
+	}
+	/* Polling again after the timeout only inside a frame so a frame that stops in the middle is dropped */
+	if(PROTOCOL_isReceiving())
+	{
+		SwTimer_start(&g_linkTimer, PROTOCOL_BYTE_TIMEOUT_MS + 1, 0, Link_notify);
+	}
+	else
+	{
+		SwTimer_cancel(&g_linkTimer);
+	}
+}
+
+/*
+ * Description:
+ * Task of the door cycle, a state machine driven by the requests and the step timer
+ * A stop request stops the door in any state, an open request starts the cycle from the
+ * time given to the HMI_ECU with the verdict, see Door_resumeTime
+ */
+void Door_task(uint8 a_events)
+{
+	if(a_events & DOOR_EVENT_STOP)
+	{
+		/* The motor was stopped in the Rx interrupt and stays stopped by the latch */
+		SwTimer_cancel(&g_doorTimer);
+		Door_rotate(STOP);
+		if((g_doorState != DOOR_CLOSED) && (g_doorState != DOOR_STOPPED))
+		{
+			g_doorStopOffset = SysTime_millis() - g_doorStartTime;
+			g_doorState = DOOR_STOPPED;
+		}
+		return;
+	}
+
+	if(a_events & DOOR_EVENT_START)
+	{
+		/* A new open request, the motor can run again */
+		g_doorStopLatched = FALSE;
+		Door_start(g_doorResumeTime);
+		g_doorStopOffset = 0;
+		return;
+	}
+
+	switch(g_doorState)
+	{
+	case DOOR_CLOSED:
+	case DOOR_STOPPED:
+		break;
+	case DOOR_UNLOCKING:
+		if(a_events & DOOR_EVENT_STEP)
+		{
+			/* Stopping Door for 3 sec */
+			Door_rotate(STOP);
+			Door_enter(DOOR_OPEN, DOOR_UNLOCKING_MS + DOOR_OPEN_MS);
 		}
-		else if(option == TRIGGER)
+		break;
+	case DOOR_OPEN:
+		if(a_events & DOOR_EVENT_STEP)
 		{
-			/* Triggering buzzer for 1 min */
-			Timer0_init(&Config_Timer0);
-			Buzzer_on();
-			while(g_timer0Ticks < MINUTE);
-			/* Stopping Timer to reset it */
-			Timer0_DeInit();
-			Buzzer_off();
-			g_timer0Ticks = 0;
+			/* Closing the Door for 15 sec */
+			Door_rotate(A_CW);
+			Door_enter(DOOR_LOCKING, DOOR_UNLOCKING_MS + DOOR_OPEN_MS + DOOR_LOCKING_MS);
 		}
+		break;
+	case DOOR_LOCKING:
+		if(a_events & DOOR_EVENT_STEP)
+		{
+			Door_rotate(STOP);
+			g_doorState = DOOR_CLOSED;
+		}
+		break;
 	}
 }
 
+/*
+ * Description:
+ * Task of the alarm, the buzzer is on for 1 min
+ */
+void Alarm_task(uint8 a_events)
+{
+	if(a_events & ALARM_EVENT_START)
+	{
+		/* Triggering buzzer for 1 min */
+		Buzzer_on();
+		SwTimer_start(&g_alarmTimer, ALARM_MS, 0, Alarm_notifyStop);
+	}
+	if((a_events & ALARM_EVENT_STOP) && !SwTimer_isArmed(&g_alarmTimer))
+	{
+		Buzzer_off();
+	}
+}
 
+/*******************************************************************************
+ *                                Main Function                                *
+ *******************************************************************************/
 
+void main(void)
+{
+	/* Struct to configer UART with Baud rate = 9600 bps, one stop bit and interrupt driven buffers */
+	Uart_ConfigType Config_Uart = { 9600 , ONE_STOP_BIT , UART_BUFFERED };
+
+
+	/* Struct to configer I2C with bit rate = TWI_SCL_FREQUENCY (400 kbps) and the adress of the Microcontroller is 0x01*/
+	I2c_ConfigType  Config_I2c = { TWI_SCL_FREQUENCY , 0x01};
+
+	/* Initializing Drivers */
+	UART_init(&Config_Uart);     /* Initializing UART to communicate with HMI_ECU */
+	SysTime_init();              /* Initializing the 1 ms system time to count time for motor */
+	TWI_init(&Config_I2c);       /* Initializing I2C to communicate with eeprom */
+	DcMotor_Init();              /* Initializing DC motor to open and close door */
+	Buzzer_init();               /* Initializing buzzer for the alarm */
+	CredentialStore_init();      /* Finding the newest saved password and loading it to RAM */
+	SwTimer_init();              /* Initializing the software timers of the door cycle and the alarm */
+
+	/* A saved password was confirmed when it was set so the first password is not asked again */
+	if(CredentialStore_hasRecord())
+	{
+		g_setupStep = SETUP_DONE;
+	}
+
+	/* Creating the tasks */
+	Scheduler_createTask(&g_linkTask, Link_task);
+	Scheduler_createTask(&g_doorTask, Door_task);
+	Scheduler_createTask(&g_alarmTask, Alarm_task);
+
+	/* Every received byte wakes up the link task, the bytes received before are handled at the start */
+	UART_setRxCallBack(Link_receive);
+	Scheduler_setEvents(&g_linkTask, LINK_EVENT_RX);
+
+	/* Running the tasks, never returns */
+	Scheduler_start();
+}
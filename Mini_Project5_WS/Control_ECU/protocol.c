@@ -0,0 +1,294 @@
+ /******************************************************************************
+ *
+ * Module: Protocol
+ *
+ * File Name: protocol.c
+ *
+ * Description: Source file for the framed link protocol between the two ECUs
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#include "protocol.h"
+#include "uart.h"
+#include "crc.h"
+#include "systime.h"
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+typedef enum
+{
+	WAIT_SYNC , WAIT_LENGTH , WAIT_COMMAND , WAIT_PAYLOAD , WAIT_CRC
+}Protocol_ParserState;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* The state of the frame parser */
+static Protocol_ParserState g_parserState = WAIT_SYNC;
+
+/*
+ * Frame being received: LENGTH, COMMAND then PAYLOAD.
+ * Each byte is copied once from the UART ring buffer as it is parsed, the payload
+ * can't be left in the ring because it may wrap around the end of the ring and the
+ * Rx interrupt writes the next frame over it while the caller still uses it.
+ * The payload handed to the caller points here with no more copies.
+ */
+static uint8 g_rxFrame[2 + PROTOCOL_MAX_PAYLOAD];
+
+/* Number of bytes of the frame saved in g_rxFrame and the CRC of the frame till now */
+static uint8 g_rxFrameCount = 0;
+static uint8 g_rxCrc = CRC8_INITIAL_VALUE;
+
+/* Receive time of the last byte taken from the UART (low 16 bits of SysTime_millis), used to detect a stopped frame */
+static uint16 g_rxLastByteTime = 0;
+
+/*
+ * Bytes of rejected frames after their SYNC, parsed again before the bytes waiting in the
+ * UART because the SYNC of the next frame may be one of them. A rejected frame is at most
+ * LENGTH, COMMAND, PAYLOAD and CRC, the bytes to parse again always fit in that size.
+ */
+static uint8 g_rescan[3 + PROTOCOL_MAX_PAYLOAD];
+static uint8 g_rescanLength = 0;
+static uint8 g_rescanIndex = 0;
+
+/* Last 3 bytes seen by PROTOCOL_detectCommand in the Rx interrupt */
+static uint8 g_detectBytes[3];
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Take the next byte to parse, the bytes to parse again first then the bytes in the UART */
+static boolean PROTOCOL_nextByte(uint8 *byte);
+
+/* Drop the frame being received, its bytes after the SYNC and the last byte are parsed again */
+static void PROTOCOL_reject(uint8 byte);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Send a frame with the required command and payload to the other ECU.
+ * The payload is cut to PROTOCOL_MAX_PAYLOAD bytes.
+ */
+void PROTOCOL_sendFrame(uint8 command, const uint8 *payload, uint8 length)
+{
+	uint8 header[2];
+	uint8 crc;
+
+	if(length > PROTOCOL_MAX_PAYLOAD)
+	{
+		length = PROTOCOL_MAX_PAYLOAD;
+	}
+
+	header[0] = length;
+	header[1] = command;
+	crc = CRC8_update(CRC8_INITIAL_VALUE, header, 2);
+	crc = CRC8_update(crc, payload, length);
+
+	UART_sendByte(PROTOCOL_SYNC_BYTE);
+	UART_sendByte(header[0]);
+	UART_sendByte(header[1]);
+	for(uint8 i = 0; i < length; i++)
+	{
+		UART_sendByte(payload[i]);
+	}
+	UART_sendByte(crc);
+}
+
+/*
+ * Description :
+ * Feed the received bytes waiting in the UART to the frame parser without waiting.
+ * Returns PROTOCOL_FRAME_READY and fills frame when a valid frame is complete,
+ * PROTOCOL_FRAME_ERROR when a corrupted frame was dropped,
+ * PROTOCOL_FRAME_PENDING when no complete frame is available yet.
+ * A frame that stops in the middle for PROTOCOL_BYTE_TIMEOUT_MS is dropped, the gap is
+ * measured with the receive times of the bytes so a late call doesn't join two frames.
+ * After a corrupted frame the bytes after its SYNC are parsed again for the next SYNC.
+ */
+Protocol_Status PROTOCOL_poll(Protocol_Frame *frame)
+{
+	uint8 byte;
+
+	/* Bytes after a complete frame are left for the next call */
+	while(PROTOCOL_nextByte(&byte))
+	{
+		switch(g_parserState)
+		{
+		case WAIT_SYNC:
+			if(byte == PROTOCOL_SYNC_BYTE)
+			{
+				g_rxCrc = CRC8_INITIAL_VALUE;
+				g_rxFrameCount = 0;
+				g_parserState = WAIT_LENGTH;
+			}
+			break;
+		case WAIT_LENGTH:
+			if(byte > PROTOCOL_MAX_PAYLOAD)
+			{
+				/* Can't be a valid frame, drop it at once */
+				PROTOCOL_reject(byte);
+				return PROTOCOL_FRAME_ERROR;
+			}
+			g_rxFrame[0] = byte;
+			g_rxFrameCount = 1;
+			g_rxCrc = CRC8_update(g_rxCrc, &byte, 1);
+			g_parserState = WAIT_COMMAND;
+			break;
+		case WAIT_COMMAND:
+			g_rxFrame[1] = byte;
+			g_rxFrameCount = 2;
+			g_rxCrc = CRC8_update(g_rxCrc, &byte, 1);
+			g_parserState = (g_rxFrame[0] == 0) ? WAIT_CRC : WAIT_PAYLOAD;
+			break;
+		case WAIT_PAYLOAD:
+			g_rxFrame[g_rxFrameCount] = byte;
+			g_rxFrameCount++;
+			g_rxCrc = CRC8_update(g_rxCrc, &byte, 1);
+			if(g_rxFrameCount == (2 + g_rxFrame[0]))
+			{
+				g_parserState = WAIT_CRC;
+			}
+			break;
+		case WAIT_CRC:
+			if(byte != g_rxCrc)
+			{
+				PROTOCOL_reject(byte);
+				return PROTOCOL_FRAME_ERROR;
+			}
+			g_parserState = WAIT_SYNC;
+			frame->length = g_rxFrame[0];
+			frame->command = g_rxFrame[1];
+			frame->payload = &g_rxFrame[2];
+			return PROTOCOL_FRAME_READY;
+		}
+	}
+	/* Inside a frame and nothing arrived for the timeout */
+	if((g_parserState != WAIT_SYNC) &&
+			((uint16)((uint16)SysTime_millis() - g_rxLastByteTime) >= PROTOCOL_BYTE_TIMEOUT_MS))
+	{
+		PROTOCOL_resync();
+	}
+	return PROTOCOL_FRAME_PENDING;
+}
+
+/*
+ * Description :
+ * Check if the byte completes a frame of the command with no payload, to be called
+ * with every received byte from the Rx interrupt so the command is handled without
+ * waiting for the frame parser. The last bytes are kept for one command only.
+ * Returns TRUE when the frame is complete and its CRC is right.
+ */
+boolean PROTOCOL_detectCommand(uint8 byte, uint8 command)
+{
+	uint8 header[2] = {0, command};
+	boolean detected = FALSE;
+
+	/* The CRC is calculated only if the frame start matches */
+	if((g_detectBytes[0] == PROTOCOL_SYNC_BYTE) && (g_detectBytes[1] == 0) &&
+			(g_detectBytes[2] == command) && (byte == CRC8_update(CRC8_INITIAL_VALUE, header, 2)))
+	{
+		detected = TRUE;
+	}
+	g_detectBytes[0] = g_detectBytes[1];
+	g_detectBytes[1] = g_detectBytes[2];
+	g_detectBytes[2] = byte;
+	return detected;
+}
+
+/*
+ * Description :
+ * Wait until a valid frame is received.
+ * Corrupted frames and frames that stop in the middle are dropped.
+ */
+void PROTOCOL_receiveFrame(Protocol_Frame *frame)
+{
+	while(PROTOCOL_poll(frame) != PROTOCOL_FRAME_READY)
+	{
+	}
+}
+
+/*
+ * Description :
+ * Wait until a valid frame with the required command is received,
+ * frames with other commands are dropped.
+ */
+void PROTOCOL_receiveCommand(uint8 command, Protocol_Frame *frame)
+{
+	do
+	{
+		PROTOCOL_receiveFrame(frame);
+	}while(frame->command != command);
+}
+
+/*
+ * Description :
+ * Drop any partially received frame and wait for the next sync byte.
+ */
+void PROTOCOL_resync(void)
+{
+	g_parserState = WAIT_SYNC;
+}
+
+/*
+ * Description :
+ * Return TRUE if the parser is in the middle of a frame, PROTOCOL_poll must then be
+ * called again after PROTOCOL_BYTE_TIMEOUT_MS to drop the frame if it stopped.
+ */
+boolean PROTOCOL_isReceiving(void)
+{
+	return (g_parserState != WAIT_SYNC);
+}
+
+static boolean PROTOCOL_nextByte(uint8 *byte)
+{
+	uint16 time;
+
+	if(g_rescanIndex < g_rescanLength)
+	{
+		*byte = g_rescan[g_rescanIndex];
+		g_rescanIndex++;
+		return TRUE;
+	}
+	if(!UART_tryReceiveTimed(byte, &time))
+	{
+		return FALSE;
+	}
+	/* A frame that stopped for the timeout before this byte was received is dropped, the byte may start the next one */
+	if((g_parserState != WAIT_SYNC) && ((uint16)(time - g_rxLastByteTime) >= PROTOCOL_BYTE_TIMEOUT_MS))
+	{
+		PROTOCOL_resync();
+	}
+	g_rxLastByteTime = time;
+	return TRUE;
+}
+
+static void PROTOCOL_reject(uint8 byte)
+{
+	/*
+	 * The rejected frame started in the bytes to parse again or after them so the bytes
+	 * left are moved down in order and the rejected bytes are put before them
+	 */
+	uint8 left = g_rescanLength - g_rescanIndex;
+	uint8 i;
+
+	for(i = 0; i < left; i++)
+	{
+		g_rescan[g_rxFrameCount + 1 + i] = g_rescan[g_rescanIndex + i];
+	}
+	for(i = 0; i < g_rxFrameCount; i++)
+	{
+		g_rescan[i] = g_rxFrame[i];
+	}
+	g_rescan[g_rxFrameCount] = byte;
+	g_rescanLength = g_rxFrameCount + 1 + left;
+	g_rescanIndex = 0;
+	g_parserState = WAIT_SYNC;
+}
@@ -0,0 +1,148 @@
+ /******************************************************************************
+ *
+ * Module: Protocol
+ *
+ * File Name: protocol.h
+ *
+ * Description: Header file for the framed link protocol between the two ECUs
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include "std_types.h"
+#include "systime.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/*
+ * Frame format on the UART link:
+ * | SYNC | LENGTH | COMMAND | PAYLOAD (LENGTH bytes) | CRC-8 |
+ * The CRC-8 covers LENGTH, COMMAND and the PAYLOAD.
+ */
+#define PROTOCOL_SYNC_BYTE          0xA5
+#define PROTOCOL_MAX_PAYLOAD        16
+
+/* A frame that stops in the middle for more than this time is dropped (about 19 byte times at 9600 bps) */
+#define PROTOCOL_BYTE_TIMEOUT_MS    20
+
+/* Number of digits in the password */
+#define PASSWORD_LENGTH             5
+
+/* Define Commands in Communication between the two Controllers*/
+#define OPENDOOR          0x02  /* Means the user wants to open the door, payload is the password or empty if it was streamed */
+#define CHANGEPASS        0x03  /* Means the usaer wants to change the saved password, payload is the old then the new password or the new only if the old was streamed */
+#define TRIGGER           0x04  /* Means trigger the buzzer alarm */
+#define PASSWORD          0x06  /* Means the payload is a password of PASSWORD_LENGTH digits */
+#define VERDICT           0x07  /* Means the payload is the result of a password check */
+#define DOOR_STOP         0x08  /* Means stop the door motor at once, detected in the Rx interrupt */
+#define DIGIT             0x09  /* Means the payload is the position and the value of a password digit streamed while typed */
+#define GET_STATUS        0x0A  /* Means the HMI_ECU started and asks if the system has a password */
+#define STATUS            0x0B  /* Means the payload is the provisioning status of the system */
+
+/* Define durations of the door cycle and the alarm in ms, the same on both Controllers */
+#define DOOR_UNLOCKING_MS SYSTIME_SECONDS(15)  /* Time for the motor to open the door */
+#define DOOR_OPEN_MS      SYSTIME_SECONDS(3)   /* Time the door stays open */
+#define DOOR_LOCKING_MS   SYSTIME_SECONDS(15)  /* Time for the motor to close the door */
+#define ALARM_MS          SYSTIME_MINUTES(1)   /* Time of the buzzer alarm */
+
+/* Define the results of a password check carried by the VERDICT command */
+#define MISMATCH          0x00  /* Means the password sent doesn't match the one saved in eeprom */
+#define MATCH             0x01  /* Means the password sent matchs the one saved in eeprom */
+
+/*
+ * The VERDICT of an open request that matches carries after MATCH the phase the door
+ * cycle starts in and the time of the cycle already done in ms (high byte first),
+ * a stopped door goes on from where it is
+ */
+#define VERDICT_DOOR_LENGTH   4
+#define DOOR_PHASE_UNLOCKING  0x00  /* Means the motor opens the door */
+#define DOOR_PHASE_OPEN       0x01  /* Means the door is open and waits before it is locked */
+
+/* Define the provisioning status carried by the STATUS command */
+#define NOT_PROVISIONED   0x00  /* Means no password is saved, the first password must be set */
+#define PROVISIONED       0x01  /* Means a confirmed password is saved in eeprom */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+typedef enum
+{
+	PROTOCOL_FRAME_PENDING , PROTOCOL_FRAME_READY , PROTOCOL_FRAME_ERROR
+}Protocol_Status;
+
+/*
+ * A received frame, the payload points inside the frame buffer of the protocol
+ * (not the UART ring buffer) and stays valid until the next frame is polled.
+ */
+typedef struct
+{
+	uint8 command;
+	uint8 length;
+	const uint8 *payload;
+}Protocol_Frame;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Send a frame with the required command and payload to the other ECU.
+ * The payload is cut to PROTOCOL_MAX_PAYLOAD bytes.
+ */
+void PROTOCOL_sendFrame(uint8 command, const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Feed the received bytes waiting in the UART to the frame parser without waiting.
+ * Returns PROTOCOL_FRAME_READY and fills frame when a valid frame is complete,
+ * PROTOCOL_FRAME_ERROR when a corrupted frame was dropped,
+ * PROTOCOL_FRAME_PENDING when no complete frame is available yet.
+ * A frame that stops in the middle for PROTOCOL_BYTE_TIMEOUT_MS is dropped.
+ */
+Protocol_Status PROTOCOL_poll(Protocol_Frame *frame);
+
+/*
+ * Description :
+ * Check if the byte completes a frame of the command with no payload, to be called
+ * with every received byte from the Rx interrupt so the command is handled without
+ * waiting for the frame parser. The last bytes are kept for one command only.
+ * Returns TRUE when the frame is complete and its CRC is right.
+ */
+boolean PROTOCOL_detectCommand(uint8 byte, uint8 command);
+
+/*
+ * Description :
+ * Wait until a valid frame is received.
+ * Corrupted frames and frames that stop in the middle are dropped.
+ */
+void PROTOCOL_receiveFrame(Protocol_Frame *frame);
+
+/*
+ * Description :
+ * Wait until a valid frame with the required command is received,
+ * frames with other commands are dropped.
+ */
+void PROTOCOL_receiveCommand(uint8 command, Protocol_Frame *frame);
+
+/*
+ * Description :
+ * Drop any partially received frame and wait for the next sync byte.
+ */
+void PROTOCOL_resync(void);
+
+/*
+ * Description :
+ * Return TRUE if the parser is in the middle of a frame, PROTOCOL_poll must then be
+ * called again after PROTOCOL_BYTE_TIMEOUT_MS to drop the frame if it stopped.
+ */
+boolean PROTOCOL_isReceiving(void);
+
+#endif /* PROTOCOL_H_ */
@@ -0,0 +1,126 @@
+ /******************************************************************************
+ *
+ * Module: Scheduler
+ *
+ * File Name: scheduler.c
+ *
+ * Description: Source file for the cooperative run to completion task scheduler
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#include "scheduler.h"
+#include "swtimer.h"
+#include "systime.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Queue of the tasks that have events, shared with the interrupts */
+static Scheduler_Task *volatile g_readyHead = NULL_PTR;
+static Scheduler_Task *volatile g_readyTail = NULL_PTR;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the task with its function and no events.
+ */
+void Scheduler_createTask(Scheduler_Task *task, void (*run)(uint8 events))
+{
+	task->next = NULL_PTR;
+	task->run = run;
+	task->events = 0;
+	task->ready = FALSE;
+}
+
+/*
+ * Description :
+ * Set event flags for the task and put it in the ready queue if it is not there.
+ * Can be called from the tasks, the software timer callbacks and the interrupts.
+ */
+void Scheduler_setEvents(Scheduler_Task *task, uint8 events)
+{
+	/* The queue is changed by the interrupts too */
+	uint8 sreg = SREG;
+	cli();
+	task->events |= events;
+	if(!task->ready)
+	{
+		task->ready = TRUE;
+		task->next = NULL_PTR;
+		if(g_readyTail != NULL_PTR)
+		{
+			g_readyTail->next = task;
+		}
+		else
+		{
+			g_readyHead = task;
+		}
+		g_readyTail = task;
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Run the ready tasks in the order they became ready, between them the
+ * software timers are dispatched. When nothing is ready the CPU sleeps
+ * until the next timer expiry or an interrupt. Never returns.
+ */
+void Scheduler_start(void)
+{
+	Scheduler_Task *task;
+	uint8 events = 0;
+	uint8 sreg;
+	uint32 expiry;
+
+	while(1)
+	{
+		/* Expired timers set the events of their tasks */
+		SwTimer_dispatch();
+
+		/* Take the first ready task with its events */
+		sreg = SREG;
+		cli();
+		task = g_readyHead;
+		if(task != NULL_PTR)
+		{
+			g_readyHead = task->next;
+			if(g_readyHead == NULL_PTR)
+			{
+				g_readyTail = NULL_PTR;
+			}
+			task->ready = FALSE;
+			events = task->events;
+			task->events = 0;
+		}
+		SREG = sreg;
+
+		/* Events set while it runs make it ready again */
+		if(task != NULL_PTR)
+		{
+			task->run(events);
+		}
+		else
+		{
+			/* Nothing to do, sleeping until the next timer or an interrupt that sets events */
+			if(!SwTimer_nextExpiry(&expiry))
+			{
+				expiry = SysTime_millis() + SYSTIME_IDLE_MAX_MS;
+			}
+			cli();
+			if(g_readyHead == NULL_PTR)
+			{
+				SysTime_idle(expiry);
+			}
+			SREG = sreg;
+		}
+	}
+}
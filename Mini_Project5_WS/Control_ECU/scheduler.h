@@ -0,0 +1,61 @@
+ /******************************************************************************
+ *
+ * Module: Scheduler
+ *
+ * File Name: scheduler.h
+ *
+ * Description: Header file for the cooperative run to completion task scheduler
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/*
+ * Task control block, owned by the application (usually a static variable).
+ * A task is a function that handles its events and returns without waiting,
+ * it runs again when new events are set for it.
+ * The fields are used by the scheduler only.
+ */
+typedef struct Scheduler_Task
+{
+	struct Scheduler_Task *next;    /* Next task in the ready queue */
+	void (*run)(uint8 events);      /* Called with the events set since its last run */
+	volatile uint8 events;          /* Event flags waiting to be handled */
+	volatile boolean ready;         /* TRUE while the task is in the ready queue */
+}Scheduler_Task;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the task with its function and no events.
+ */
+void Scheduler_createTask(Scheduler_Task *task, void (*run)(uint8 events));
+
+/*
+ * Description :
+ * Set event flags for the task and put it in the ready queue if it is not there.
+ * Can be called from the tasks, the software timer callbacks and the interrupts.
+ */
+void Scheduler_setEvents(Scheduler_Task *task, uint8 events);
+
+/*
+ * Description :
+ * Run the ready tasks in the order they became ready, between them the
+ * software timers are dispatched. When nothing is ready the CPU sleeps
+ * until the next timer expiry or an interrupt. Never returns.
+ */
+void Scheduler_start(void);
+
+#endif /* SCHEDULER_H_ */
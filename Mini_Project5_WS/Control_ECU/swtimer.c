@@ -0,0 +1,224 @@
+ /******************************************************************************
+ *
+ * Module: Software Timer
+ *
+ * File Name: swtimer.c
+ *
+ * Description: Source file for the software timer wheel on top of the system time
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#include "swtimer.h"
+#include "systime.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Lists of the armed timers, a timer is in the slot of its expiry time */
+static SwTimer *g_wheel[SWTIMER_WHEEL_SIZE];
+
+/* Last system time handled by SwTimer_dispatch */
+static uint32 g_lastTick = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Put the timer in the slot of its expiry time */
+static void SwTimer_link(SwTimer *timer);
+
+/* Take the timer out of its slot */
+static void SwTimer_unlink(SwTimer *timer);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the wheel with no timers, the system time must be initialized first.
+ */
+void SwTimer_init(void)
+{
+	for(uint8 slot = 0; slot < SWTIMER_WHEEL_SIZE; slot++)
+	{
+		g_wheel[slot] = NULL_PTR;
+	}
+	g_lastTick = SysTime_millis();
+}
+
+/*
+ * Description :
+ * Arm the timer to call callback after delay_ms milliseconds (at least 1),
+ * then every period_ms milliseconds if period_ms is not 0.
+ * A timer that is already armed is re-armed. Takes constant time.
+ */
+void SwTimer_start(SwTimer *timer, uint32 delay_ms, uint32 period_ms, void (*callback)(void))
+{
+	/* At least 1 ms so it never goes to a slot that was already handled */
+	if(delay_ms == 0)
+	{
+		delay_ms = 1;
+	}
+	SwTimer_startAt(timer, SysTime_millis() + delay_ms, period_ms, callback);
+}
+
+/*
+ * Description :
+ * Arm the timer to call callback at the system time expiry, then every period_ms
+ * milliseconds if period_ms is not 0. An expiry time that passed is handled in the
+ * next dispatch. A timer that is already armed is re-armed. Takes constant time.
+ */
+void SwTimer_startAt(SwTimer *timer, uint32 expiry, uint32 period_ms, void (*callback)(void))
+{
+	SwTimer_cancel(timer);
+
+	/* A passed time goes to the next slot to handle, not to a slot that was already handled */
+	if((sint32)(expiry - g_lastTick) <= 0)
+	{
+		expiry = g_lastTick + 1;
+	}
+	timer->expiry = expiry;
+	timer->period = period_ms;
+	timer->callback = callback;
+	SwTimer_link(timer);
+}
+
+/*
+ * Description :
+ * Disarm the timer if it is armed. Takes constant time.
+ */
+void SwTimer_cancel(SwTimer *timer)
+{
+	if(timer->armed)
+	{
+		SwTimer_unlink(timer);
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE if the timer is armed.
+ */
+boolean SwTimer_isArmed(const SwTimer *timer)
+{
+	return timer->armed;
+}
+
+/*
+ * Description :
+ * Save the earliest expiry time of the armed timers in expiry.
+ * Returns FALSE if no timer is armed. Takes time with the number of slots and timers.
+ */
+boolean SwTimer_nextExpiry(uint32 *expiry)
+{
+	boolean found = FALSE;
+	SwTimer *timer;
+
+	for(uint8 slot = 0; slot < SWTIMER_WHEEL_SIZE; slot++)
+	{
+		for(timer = g_wheel[slot]; timer != NULL_PTR; timer = timer->next)
+		{
+			/* Signed difference so the wrap of the time doesn't matter */
+			if((!found) || ((sint32)(timer->expiry - *expiry) < 0))
+			{
+				*expiry = timer->expiry;
+				found = TRUE;
+			}
+		}
+	}
+	return found;
+}
+
+/*
+ * Description :
+ * Call the callbacks of the expired timers, to be called from the main loop.
+ * The callbacks run here and not in the tick interrupt.
+ */
+void SwTimer_dispatch(void)
+{
+	uint32 now = SysTime_millis();
+	SwTimer *timer;
+	uint8 slot;
+
+	/* After a long time without dispatch one turn of the wheel handles every slot */
+	if((now - g_lastTick) > SWTIMER_WHEEL_SIZE)
+	{
+		g_lastTick = now - SWTIMER_WHEEL_SIZE;
+	}
+
+	while(g_lastTick != now)
+	{
+		g_lastTick++;
+		slot = (uint8)(g_lastTick & (SWTIMER_WHEEL_SIZE - 1));
+
+		/*
+		 * Take the expired timers one by one from the start of the list
+		 * because a callback may start or cancel any timer
+		 */
+		do
+		{
+			for(timer = g_wheel[slot]; timer != NULL_PTR; timer = timer->next)
+			{
+				if((sint32)(now - timer->expiry) >= 0)
+				{
+					break;
+				}
+			}
+			if(timer != NULL_PTR)
+			{
+				SwTimer_unlink(timer);
+				if(timer->period != 0)
+				{
+					/* Periodic: keep the period phase, skip the periods that were missed */
+					timer->expiry += timer->period;
+					if((sint32)(now - timer->expiry) >= 0)
+					{
+						timer->expiry = now + timer->period;
+					}
+					SwTimer_link(timer);
+				}
+				timer->callback();
+			}
+		}while(timer != NULL_PTR);
+	}
+}
+
+static void SwTimer_link(SwTimer *timer)
+{
+	uint8 slot = (uint8)(timer->expiry & (SWTIMER_WHEEL_SIZE - 1));
+
+	/* Add it at the head of its slot */
+	timer->prev = NULL_PTR;
+	timer->next = g_wheel[slot];
+	if(g_wheel[slot] != NULL_PTR)
+	{
+		g_wheel[slot]->prev = timer;
+	}
+	g_wheel[slot] = timer;
+	timer->armed = TRUE;
+}
+
+static void SwTimer_unlink(SwTimer *timer)
+{
+	uint8 slot = (uint8)(timer->expiry & (SWTIMER_WHEEL_SIZE - 1));
+
+	if(timer->prev != NULL_PTR)
+	{
+		timer->prev->next = timer->next;
+	}
+	else
+	{
+		g_wheel[slot] = timer->next;
+	}
+	if(timer->next != NULL_PTR)
+	{
+		timer->next->prev = timer->prev;
+	}
+	timer->next = NULL_PTR;
+	timer->prev = NULL_PTR;
+	timer->armed = FALSE;
+}
@@ -0,0 +1,104 @@
+ /******************************************************************************
+ *
+ * Module: Software Timer
+ *
+ * File Name: swtimer.h
+ *
+ * Description: Header file for the software timer wheel on top of the system time
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#ifndef SWTIMER_H_
+#define SWTIMER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/*
+ * Number of slots in the wheel, one slot per 1 ms tick, must be a power of 2.
+ * A timer goes to the slot of its expiry time, timers further than one turn
+ * of the wheel wait in their slot until their expiry time is reached.
+ */
+#define SWTIMER_WHEEL_SIZE     32
+
+#if ((SWTIMER_WHEEL_SIZE & (SWTIMER_WHEEL_SIZE - 1)) != 0)
+#error "SWTIMER_WHEEL_SIZE must be a power of 2"
+#endif
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/*
+ * A software timer, owned by the caller (usually a static variable) so any
+ * number of timers can be used without a fixed table.
+ * The fields are used by the wheel only.
+ */
+typedef struct SwTimer
+{
+	struct SwTimer *next;
+	struct SwTimer *prev;
+	uint32 expiry;            /* System time of the next expiry */
+	uint32 period;            /* 0 for a one-shot timer */
+	void (*callback)(void);
+	boolean armed;
+}SwTimer;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the wheel with no timers, the system time must be initialized first.
+ */
+void SwTimer_init(void);
+
+/*
+ * Description :
+ * Arm the timer to call callback after delay_ms milliseconds (at least 1),
+ * then every period_ms milliseconds if period_ms is not 0.
+ * A timer that is already armed is re-armed. Takes constant time.
+ */
+void SwTimer_start(SwTimer *timer, uint32 delay_ms, uint32 period_ms, void (*callback)(void));
+
+/*
+ * Description :
+ * Arm the timer to call callback at the system time expiry, then every period_ms
+ * milliseconds if period_ms is not 0. An expiry time that passed is handled in the
+ * next dispatch. A timer that is already armed is re-armed. Takes constant time.
+ */
+void SwTimer_startAt(SwTimer *timer, uint32 expiry, uint32 period_ms, void (*callback)(void));
+
+/*
+ * Description :
+ * Disarm the timer if it is armed. Takes constant time.
+ */
+void SwTimer_cancel(SwTimer *timer);
+
+/*
+ * Description :
+ * Return TRUE if the timer is armed.
+ */
+boolean SwTimer_isArmed(const SwTimer *timer);
+
+/*
+ * Description :
+ * Save the earliest expiry time of the armed timers in expiry.
+ * Returns FALSE if no timer is armed. Takes time with the number of slots and timers.
+ */
+boolean SwTimer_nextExpiry(uint32 *expiry);
+
+/*
+ * Description :
+ * Call the callbacks of the expired timers, to be called from the main loop.
+ * The callbacks run here and not in the tick interrupt.
+ */
+void SwTimer_dispatch(void);
+
+#endif /* SWTIMER_H_ */
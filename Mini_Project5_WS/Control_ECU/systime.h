@@ -0,0 +1,97 @@
+ /******************************************************************************
+ *
+ * Module: System Time
+ *
+ * File Name: systime.h
+ *
+ * Description: Header file for the millisecond system clock based on Timer0
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#ifndef SYSTIME_H_
+#define SYSTIME_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/*
+ * Timer0 runs in CTC mode with F_CPU/64 and interrupts every 1 ms:
+ * 8 MHz / 64 = 125 kHz so the compare value is 125 - 1
+ */
+#define SYSTIME_PRESCALER         64UL
+#define SYSTIME_OCR0_VALUE        (((F_CPU) / (SYSTIME_PRESCALER * 1000UL)) - 1)
+
+#if (((F_CPU) % (SYSTIME_PRESCALER * 1000UL)) != 0) || (SYSTIME_OCR0_VALUE > 255)
+#error "F_CPU can't give an exact 1 ms tick with the Timer0 prescaler SYSTIME_PRESCALER"
+#endif
+
+/*
+ * While the CPU sleeps Timer0 runs with F_CPU/1024 (128 us per count) and interrupts
+ * once at the next deadline, at most SYSTIME_IDLE_MAX_MS later, instead of every 1 ms.
+ * The time is counted in units of one F_CPU/64 count (8 us) so no part of a ms is lost
+ * when the tick is changed.
+ */
+#define SYSTIME_IDLE_PRESCALER    1024UL
+#define SYSTIME_IDLE_MAX_MS       32
+#define SYSTIME_UNITS_PER_MS      ((F_CPU) / (SYSTIME_PRESCALER * 1000UL))
+#define SYSTIME_UNITS_PER_COUNT   (SYSTIME_IDLE_PRESCALER / SYSTIME_PRESCALER)
+
+#if ((SYSTIME_IDLE_MAX_MS * SYSTIME_UNITS_PER_MS) / SYSTIME_UNITS_PER_COUNT) > 256
+#error "SYSTIME_IDLE_MAX_MS is too long for the 8-bit Timer0 with SYSTIME_IDLE_PRESCALER"
+#endif
+
+/* Durations are given to the deadline functions in milliseconds */
+#define SYSTIME_SECONDS(s)        ((uint32)(s) * 1000UL)
+#define SYSTIME_MINUTES(m)        ((uint32)(m) * 60000UL)
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start Timer0 in CTC mode with a 1 ms tick and clear the time.
+ */
+void SysTime_init(void);
+
+/*
+ * Description :
+ * Sleep in Idle mode with the slow tick until the deadline or any interrupt, then go back
+ * to the 1 ms tick with the time slept added. The time doesn't advance for the interrupts
+ * that run while the CPU sleeps.
+ * Must be called with the interrupts disabled after checking there is nothing to do,
+ * the interrupts are enabled when it returns.
+ */
+void SysTime_idle(uint32 deadline);
+
+/*
+ * Description :
+ * Return the milliseconds since SysTime_init, read atomically against the tick interrupt.
+ * It wraps after about 49 days, the deadline functions take care of the wrap.
+ */
+uint32 SysTime_millis(void);
+
+/*
+ * Description :
+ * Return the time duration_ms milliseconds after the time start.
+ */
+uint32 SysTime_deadline(uint32 start, uint32 duration_ms);
+
+/*
+ * Description :
+ * Return TRUE if the deadline is reached.
+ */
+boolean SysTime_isExpired(uint32 deadline);
+
+/*
+ * Description :
+ * Wait until the deadline is reached.
+ */
+void SysTime_waitUntil(uint32 deadline);
+
+#endif /* SYSTIME_H_ */
@@ -14,13 +14,147 @@
 
 #include "common_macros.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Transactions waiting for the bus, the head is moved by TWI_submit and the tail by the ISR */
+static TWI_Transaction * volatile g_queue[TWI_QUEUE_SIZE];
+static volatile uint8 g_queueHead = 0;
+static volatile uint8 g_queueTail = 0;
+
+/* The transaction on the bus now and its progress */
+static TWI_Transaction * volatile g_current = NULL_PTR;
+static volatile uint8 g_index = 0;
+static volatile uint16 g_retriesLeft = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Take the next transaction from the queue and send its START, called with interrupts disabled */
+static void TWI_startNext(uint8 twcr_flags);
+
+/* End the current transaction with the required status and start the next one */
+static void TWI_finish(TWI_TransactionStatus status);
+
+/* Calculate TWBR and TWPS for an SCL frequency that is not known at compile time */
+static void TWI_calculateBitRate(uint32 scl_frequency, uint8 *twbr, uint8 *twps);
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/* Interrupt Service Routine for the TWI, runs the current transaction one bus event at a time */
+ISR(TWI_vect)
+{
+	TWI_Transaction *transaction = g_current;
+
+	switch(TWI_getStatus())
+	{
+	case TWI_START:
+		g_index = 0;
+		/* Start with the write part, or with the read part if there is nothing to write */
+		if((transaction->write_length == 0) && (transaction->read_length > 0))
+		{
+			TWDR = (uint8)((transaction->slave_address << 1) | 1);
+		}
+		else
+		{
+			TWDR = (uint8)(transaction->slave_address << 1);
+		}
+		TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+		break;
+	case TWI_REP_START:
+		g_index = 0;
+		/* The write part is done, send the address with the read request */
+		TWDR = (uint8)((transaction->slave_address << 1) | 1);
+		TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+		break;
+	case TWI_MT_SLA_W_ACK:
+	case TWI_MT_DATA_ACK:
+		if(g_index < transaction->write_length)
+		{
+			TWDR = transaction->write_data[g_index];
+			g_index++;
+			TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+		}
+		else if(transaction->read_length > 0)
+		{
+			/* Send the repeated START for the read part */
+			TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+		}
+		else
+		{
+			TWI_finish(TWI_TRANSACTION_DONE);
+		}
+		break;
+	case TWI_MT_SLA_W_NACK:
+	case TWI_MT_SLA_R_NACK:
+		if(g_retriesLeft > 0)
+		{
+			/* The slave is busy, send STOP then START and try again from the beginning */
+			g_retriesLeft--;
+			TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+		}
+		else
+		{
+			TWI_finish(TWI_TRANSACTION_FAILED);
+		}
+		break;
+	case TWI_MT_SLA_R_ACK:
+		/* ACK the received bytes except the last one */
+		if(transaction->read_length > 1)
+		{
+			TWCR = (1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+		}
+		else
+		{
+			TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+		}
+		break;
+	case TWI_MR_DATA_ACK:
+		transaction->read_data[g_index] = TWDR;
+		g_index++;
+		if(g_index < (transaction->read_length - 1))
+		{
+			TWCR = (1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+		}
+		else
+		{
+			TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+		}
+		break;
+	case TWI_MR_DATA_NACK:
+		transaction->read_data[g_index] = TWDR;
+		TWI_finish(TWI_TRANSACTION_DONE);
+		break;
+	default:
+		/* Data NACK, arbitration lost or bus error */
+		TWI_finish(TWI_TRANSACTION_FAILED);
+		break;
+	}
+}
 
 void TWI_init(I2c_ConfigType * Configtype_PTR)
 {
-    /* Bit Rate: 400.000 kbps using zero pre-scaler TWPS=00 and F_CPU=8Mhz */
-    /* Bit Rate: 100.000 kbps using 0x02 pre-scaler TWPS=0x02 and F_CPU=8Mhz */
-    TWBR = 0x02;
-	TWSR = Configtype_PTR->speed;
+    uint8 twbr , twps;
+
+    /* SCL frequency = F_CPU / (16 + 2 * TWBR * 4^TWPS) */
+    if(Configtype_PTR->scl_frequency == TWI_SCL_FREQUENCY)
+    {
+        /* Calculated and checked at compile time */
+        twbr = TWI_TWBR_VALUE;
+        twps = TWI_TWPS_VALUE;
+    }
+    else
+    {
+        TWI_calculateBitRate(Configtype_PTR->scl_frequency, &twbr, &twps);
+    }
+    TWBR = twbr;
+	TWSR = twps;
 	
     /* Two Wire Bus address my address if any master device want to call me: 0x1 (used in case this MC is a slave device)
        General Call Recognition: Off */
@@ -99,3 +233,100 @@ uint8 TWI_getStatus(void)
     status = TWSR & 0xF8;
     return status;
 }
+
+boolean TWI_submit(TWI_Transaction *transaction)
+{
+	uint8 sreg = SREG;
+
+	/*
+	 * The queue is changed by the ISR too so it is updated with the interrupts disabled,
+	 * the interrupts state of the caller is restored so it can be called from a callback
+	 */
+	cli();
+	if((uint8)(g_queueHead - g_queueTail) >= TWI_QUEUE_SIZE)
+	{
+		/* Queue is full */
+		SREG = sreg;
+		return FALSE;
+	}
+
+	transaction->status = TWI_TRANSACTION_PENDING;
+	g_queue[g_queueHead % TWI_QUEUE_SIZE] = transaction;
+	g_queueHead++;
+
+	/* Start it now if the bus is free, the ISR starts it otherwise */
+	if(g_current == NULL_PTR)
+	{
+		/* Wait for the STOP of the previous transaction to be sent */
+		while(BIT_IS_SET(TWCR,TWSTO));
+		TWI_startNext(0);
+	}
+	SREG = sreg;
+
+	return TRUE;
+}
+
+boolean TWI_isBusy(void)
+{
+	return (g_current != NULL_PTR) || (g_queueHead != g_queueTail);
+}
+
+static void TWI_startNext(uint8 twcr_flags)
+{
+	if(g_queueHead == g_queueTail)
+	{
+		g_current = NULL_PTR;
+		/* Nothing waiting, just send the flags (STOP) with the interrupt disabled */
+		TWCR = (1 << TWINT) | (1 << TWEN) | twcr_flags;
+		return;
+	}
+
+	g_current = g_queue[g_queueTail % TWI_QUEUE_SIZE];
+	g_queueTail++;
+	g_retriesLeft = g_current->nack_retries;
+
+	/* Send the START, after the STOP of the previous transaction if any */
+	TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE) | twcr_flags;
+}
+
+static void TWI_finish(TWI_TransactionStatus status)
+{
+	TWI_Transaction *transaction = g_current;
+
+	transaction->status = status;
+	/* Send the STOP and start the next transaction before calling back the owner */
+	TWI_startNext(1 << TWSTO);
+
+	if(transaction->callback != NULL_PTR)
+	{
+		transaction->callback(transaction);
+	}
+}
+
+static void TWI_calculateBitRate(uint32 scl_frequency, uint8 *twbr, uint8 *twps)
+{
+	uint32 bit_rate;
+
+	/* Too high for F_CPU: use the fastest possible */
+	if((scl_frequency == 0) || (F_CPU < (16UL * scl_frequency)))
+	{
+		*twbr = 0;
+		*twps = 0;
+		return;
+	}
+
+	/* Use the smallest prescaler that gives TWBR in range for the best resolution */
+	for(*twps = 0; *twps < 4; (*twps)++)
+	{
+		bit_rate = TWI_TWBR_FOR(scl_frequency, (1UL << (2 * (*twps))));
+		if(bit_rate <= 255)
+		{
+			*twbr = (uint8)bit_rate;
+			return;
+		}
+	}
+
+	/* Too low for F_CPU: use the slowest possible */
+	*twbr = 255;
+	*twps = 3;
+}
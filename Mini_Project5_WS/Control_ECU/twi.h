@@ -23,27 +23,111 @@
 #define TWI_START         0x08 /* start has been sent */
 #define TWI_REP_START     0x10 /* repeated start */
 #define TWI_MT_SLA_W_ACK  0x18 /* Master transmit ( slave address + Write request ) to slave + ACK received from slave. */
+#define TWI_MT_SLA_W_NACK 0x20 /* Master transmit ( slave address + Write request ) to slave + NACK received from slave. */
 #define TWI_MT_SLA_R_ACK  0x40 /* Master transmit ( slave address + Read request ) to slave + ACK received from slave. */
+#define TWI_MT_SLA_R_NACK 0x48 /* Master transmit ( slave address + Read request ) to slave + NACK received from slave. */
 #define TWI_MT_DATA_ACK   0x28 /* Master transmit data and ACK has been received from Slave. */
+#define TWI_MT_DATA_NACK  0x30 /* Master transmit data and NACK has been received from Slave. */
 #define TWI_MR_DATA_ACK   0x50 /* Master received data and send ACK to slave. */
 #define TWI_MR_DATA_NACK  0x58 /* Master received data but doesn't send ACK to slave. */
+
+/* Maximum number of transactions waiting for the bus in the asynchronous mode */
+#define TWI_QUEUE_SIZE    4
+
+/* Common SCL frequencies in Hz */
+#define TWI_STANDARD_MODE     100000UL
+#define TWI_FAST_MODE         400000UL
+#define TWI_FAST_MODE_PLUS    1000000UL
+
+/*
+ * SCL frequency used by the application, its TWBR and TWPS values are calculated here
+ * at compile time and the build fails if it can't be reached within TWI_SCL_TOLERANCE_PERCENT
+ */
+#ifndef TWI_SCL_FREQUENCY
+#define TWI_SCL_FREQUENCY         TWI_FAST_MODE
+#endif
+#define TWI_SCL_TOLERANCE_PERCENT 5
+
+/*
+ * SCL frequency = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+ * TWBR for a prescaler (4^TWPS) rounded to the nearest value
+ */
+#define TWI_TWBR_FOR(scl, prescaler) \
+	(((F_CPU) - (16UL * (scl)) + ((prescaler) * (scl))) / (2UL * (prescaler) * (scl)))
+
+#if ((F_CPU) < (16UL * (TWI_SCL_FREQUENCY)))
+#error "TWI_SCL_FREQUENCY is too high for F_CPU"
+#elif (TWI_TWBR_FOR(TWI_SCL_FREQUENCY, 1) <= 255)
+#define TWI_TWPS_VALUE    0
+#define TWI_TWBR_VALUE    TWI_TWBR_FOR(TWI_SCL_FREQUENCY, 1)
+#elif (TWI_TWBR_FOR(TWI_SCL_FREQUENCY, 4) <= 255)
+#define TWI_TWPS_VALUE    1
+#define TWI_TWBR_VALUE    TWI_TWBR_FOR(TWI_SCL_FREQUENCY, 4)
+#elif (TWI_TWBR_FOR(TWI_SCL_FREQUENCY, 16) <= 255)
+#define TWI_TWPS_VALUE    2
+#define TWI_TWBR_VALUE    TWI_TWBR_FOR(TWI_SCL_FREQUENCY, 16)
+#elif (TWI_TWBR_FOR(TWI_SCL_FREQUENCY, 64) <= 255)
+#define TWI_TWPS_VALUE    3
+#define TWI_TWBR_VALUE    TWI_TWBR_FOR(TWI_SCL_FREQUENCY, 64)
+#else
+#error "TWI_SCL_FREQUENCY is too low for F_CPU"
+#endif
+
+#ifdef TWI_TWBR_VALUE
+/* The SCL frequency that TWI_TWBR_VALUE and TWI_TWPS_VALUE really give */
+#define TWI_SCL_ACTUAL    ((F_CPU) / (16UL + (2UL * (TWI_TWBR_VALUE) * (1UL << (2 * (TWI_TWPS_VALUE))))))
+
+#if (((TWI_SCL_ACTUAL) > (TWI_SCL_FREQUENCY)) && \
+		((100UL * ((TWI_SCL_ACTUAL) - (TWI_SCL_FREQUENCY))) > ((TWI_SCL_TOLERANCE_PERCENT) * (TWI_SCL_FREQUENCY)))) || \
+	(((TWI_SCL_ACTUAL) < (TWI_SCL_FREQUENCY)) && \
+		((100UL * ((TWI_SCL_FREQUENCY) - (TWI_SCL_ACTUAL))) > ((TWI_SCL_TOLERANCE_PERCENT) * (TWI_SCL_FREQUENCY))))
+#error "TWI_SCL_FREQUENCY can't be reached within TWI_SCL_TOLERANCE_PERCENT with this F_CPU"
+#endif
+#endif /* TWI_TWBR_VALUE */
 /*******************************************************************************
  *                         Types Declaration                                   *
  *******************************************************************************/
-typedef enum
-{
-	NORMAL_MODE = 0x02 , FAST_MODE = 0x00
-}I2c_Speed;
-
 typedef struct
 {
-	I2c_Speed speed;
+	uint32 scl_frequency; /* SCL frequency in Hz */
 	uint8 my_adress ;
 }I2c_ConfigType;
 
+typedef enum
+{
+	TWI_TRANSACTION_PENDING , TWI_TRANSACTION_DONE , TWI_TRANSACTION_FAILED
+}TWI_TransactionStatus;
+
+/*
+ * Descriptor of an asynchronous transaction:
+ * START, slave address + W, write_length bytes from write_data,
+ * then if read_length > 0: repeated START, slave address + R, read_length bytes to read_data,
+ * then STOP.
+ * If the slave doesn't ACK its address (busy) the START is repeated up to nack_retries times.
+ * The descriptor and its buffers must stay valid until the transaction ends.
+ */
+typedef struct TWI_Transaction
+{
+	uint8 slave_address;       /* 7-bit address of the slave */
+	const uint8 *write_data;
+	uint8 write_length;
+	uint8 *read_data;
+	uint8 read_length;
+	uint16 nack_retries;
+	/* Called from the TWI interrupt when the transaction ends, may be NULL_PTR */
+	void (*callback)(struct TWI_Transaction *transaction);
+	volatile TWI_TransactionStatus status;
+}TWI_Transaction;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
+/*
+ * Description :
+ * Initialize the TWI with the required SCL frequency and own address.
+ * TWI_SCL_FREQUENCY uses the values calculated at compile time,
+ * other frequencies are calculated here and limited to what the hardware can reach.
+ */
 void TWI_init(I2c_ConfigType * Configtype_PTR);
 void TWI_start(void);
 void TWI_stop(void);
@@ -52,5 +136,20 @@ uint8 TWI_readByteWithACK(void);
 uint8 TWI_readByteWithNACK(void);
 uint8 TWI_getStatus(void);
 
+/*
+ * Description :
+ * Queue a transaction to be run in the background by the TWI interrupt.
+ * Returns TRUE if it was queued or FALSE if the queue is full.
+ * The blocking functions above must not be used while TWI_isBusy() is TRUE,
+ * the blocking EEPROM functions check it and return ERROR.
+ */
+boolean TWI_submit(TWI_Transaction *transaction);
+
+/*
+ * Description :
+ * Return TRUE if a transaction is running or waiting in the queue.
+ */
+boolean TWI_isBusy(void);
+
 
 #endif /* TWI_H_ */
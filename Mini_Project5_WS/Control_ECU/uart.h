@@ -15,16 +15,44 @@
 
 #include "std_types.h"
 
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/*
+ * Sizes of the ring buffers used in the buffered (interrupt driven) mode.
+ * Must be a power of 2 and not more than 128 so the indices can be masked
+ * and the number of waiting bytes always fits in a uint8.
+ */
+#define UART_RX_BUFFER_SIZE       32
+#define UART_TX_BUFFER_SIZE       32
+
+#if ((UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) != 0) || (UART_RX_BUFFER_SIZE > 128)
+#error "UART_RX_BUFFER_SIZE must be a power of 2 and not more than 128"
+#endif
+
+#if ((UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) != 0) || (UART_TX_BUFFER_SIZE > 128)
+#error "UART_TX_BUFFER_SIZE must be a power of 2 and not more than 128"
+#endif
+
 /*******************************************************************************
  *                         Types Declaration                                   *
  *******************************************************************************/
 
 typedef enum {ONE_STOP_BIT , TWO_STOP_BITS}Bits_Num;
 
+/*
+ * UART_POLLING : send and receive by busy waiting on the UDRE and RXC flags.
+ * UART_BUFFERED: send and receive through ring buffers served by the
+ *                USART_RXC and USART_UDRE interrupts.
+ */
+typedef enum {UART_POLLING , UART_BUFFERED}Uart_Mode;
+
 typedef struct
 {
 	uint32 baud_rate;
 	Bits_Num stop_bits_num;
+	Uart_Mode mode;
 
 }Uart_ConfigType;
 
@@ -44,15 +72,51 @@ void UART_init(Uart_ConfigType * ConfigType_PTR);
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
+ * In buffered mode it waits only if the Tx buffer is full.
  */
 void UART_sendByte(const uint8 data);
 
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * In buffered mode it waits only if the Rx buffer is empty.
  */
 uint8 UART_recieveByte(void);
 
+/*
+ * Description :
+ * Put a byte in the Tx buffer without waiting (buffered mode only).
+ * Returns TRUE if the byte was queued or FALSE if the Tx buffer is full.
+ */
+boolean UART_enqueue(const uint8 data);
+
+/*
+ * Description :
+ * Take a received byte without waiting.
+ * Returns TRUE and saves the byte in data if one was available, FALSE otherwise.
+ */
+boolean UART_tryReceive(uint8 *data);
+
+/*
+ * Description :
+ * Same as UART_tryReceive and also saves in time_ms the low 16 bits of SysTime_millis
+ * when the byte was received, taken in the Rx interrupt in buffered mode.
+ */
+boolean UART_tryReceiveTimed(uint8 *data, uint16 *time_ms);
+
+/*
+ * Description :
+ * Return the number of received bytes waiting to be read.
+ */
+uint8 UART_available(void);
+
+/*
+ * Description :
+ * Set the function called from the Rx interrupt with every received byte (buffered mode only).
+ * The byte is in the Rx buffer too, the function runs in interrupt context so it must be short.
+ */
+void UART_setRxCallBack(void(*a_ptr)(uint8 data));
+
 /*
  * Description :
  * Send the required string through UART to the other UART device.
@@ -4,26 +4,41 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../crc.c \
 ../gpio.c \
 ../keypad.c \
 ../lcd.c \
 ../main.c \
+../protocol.c \
+../scheduler.c \
+../swtimer.c \
+../systime.c \
 ../timer0.c \
 ../uart.c 
 
 C_DEPS += \
+./crc.d \
 ./gpio.d \
 ./keypad.d \
 ./lcd.d \
 ./main.d \
+./protocol.d \
+./scheduler.d \
+./swtimer.d \
+./systime.d \
 ./timer0.d \
 ./uart.d 
 
 OBJS += \
+./crc.o \
 ./gpio.o \
 ./keypad.o \
 ./lcd.o \
 ./main.o \
+./protocol.o \
+./scheduler.o \
+./swtimer.o \
+./systime.o \
 ./timer0.o \
 ./uart.o 
 
@@ -32,7 +47,7 @@ OBJS += \
 %.o: ../%.c subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: AVR Compiler'
-	avr-gcc -Wall -g2 -gstabs -O0 -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega16 -DF_CPU=1000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
+	avr-gcc -Wall -g2 -gstabs -Os -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega16 -DF_CPU=1000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
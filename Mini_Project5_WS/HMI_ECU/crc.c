@@ -0,0 +1,45 @@
+ /******************************************************************************
+ *
+ * Module: CRC
+ *
+ * File Name: crc.c
+ *
+ * Description: Source file for the CRC-8 checksum used on the link and in memory
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#include "crc.h"
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Update the CRC-8 value crc with length bytes from data and return it.
+ * Start with CRC8_INITIAL_VALUE, the function can be called on consecutive blocks.
+ */
+uint8 CRC8_update(uint8 crc, const uint8 *data, uint8 length)
+{
+	uint8 i , bit;
+
+	for(i = 0; i < length; i++)
+	{
+		crc ^= data[i];
+		/* Shift out the 8 bits of the byte one by one */
+		for(bit = 0; bit < 8; bit++)
+		{
+			if(crc & 0x80)
+			{
+				crc = (uint8)((crc << 1) ^ CRC8_POLYNOMIAL);
+			}
+			else
+			{
+				crc = (uint8)(crc << 1);
+			}
+		}
+	}
+	return crc;
+}
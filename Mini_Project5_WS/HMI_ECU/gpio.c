@@ -13,6 +13,7 @@
 #include "gpio.h"
 #include "common_macros.h" /* To use the macros like SET_BIT */
 #include "avr/io.h" /* To use the IO Ports Registers */
+#include <avr/interrupt.h> /* To mask the interrupts in the masked writes */
 
 /*
  * Description :
@@ -329,3 +330,57 @@ uint8 GPIO_readPort(uint8 port_num)
 
 	return value;
 }
+
+/*
+ * Description :
+ * Write the bits of value selected by mask on the required port, the other pins are not changed.
+ * The pins are changed together in one read-modify-write with the interrupts masked.
+ * If the input port number is not correct, The function will not handle the request.
+ */
+void GPIO_writePortMasked(uint8 port_num, uint8 mask, uint8 value)
+{
+	uint8 sreg;
+
+	/*
+	 * Check if the input number is greater than NUM_OF_PORTS value.
+	 * In this case the input is not valid port number
+	 */
+	if(port_num >= NUM_OF_PORTS)
+	{
+		/* Do Nothing */
+	}
+	else
+	{
+		/* No interrupt can change the port between the read and the write */
+		sreg = SREG;
+		cli();
+		/* Write the masked port value as required */
+		switch(port_num)
+		{
+		case PORTA_ID:
+			PORTA = (PORTA & ~mask) | (value & mask);
+			break;
+		case PORTB_ID:
+			PORTB = (PORTB & ~mask) | (value & mask);
+			break;
+		case PORTC_ID:
+			PORTC = (PORTC & ~mask) | (value & mask);
+			break;
+		case PORTD_ID:
+			PORTD = (PORTD & ~mask) | (value & mask);
+			break;
+		}
+		SREG = sreg;
+	}
+}
+
+/*
+ * Description :
+ * Read and return the value of the pins selected by mask in the required port, the other bits are zero.
+ * All the pins are read at the same time.
+ * If the input port number is not correct, The function will return ZERO value.
+ */
+uint8 GPIO_readPortMasked(uint8 port_num, uint8 mask)
+{
+	return GPIO_readPort(port_num) & mask;
+}
@@ -14,6 +14,8 @@
 #define GPIO_H_
 
 #include "std_types.h"
+#include <avr/io.h> /* For the registers used by the compile time pin access */
+#include <avr/interrupt.h> /* To mask the interrupts in the masked writes */
 
 /*******************************************************************************
  *                                Definitions                                  *
@@ -35,6 +37,62 @@
 #define PIN6_ID                6
 #define PIN7_ID                7
 
+/*
+ * Compile time pin access for the port and pin IDs that are constants.
+ * The ID is pasted to the name of the register so the access is one register
+ * operation (SBI/CBI/SBIS/SBIC for single bits when optimized) with no switch
+ * and no range check, a wrong port ID doesn't compile.
+ * The functions below are kept for the IDs known at run time only.
+ */
+#define GPIO_CONCAT(a,b)                       GPIO_CONCAT_EXPANDED(a,b)
+#define GPIO_CONCAT_EXPANDED(a,b)              a##b
+
+#define GPIO_PORT_REG(port_id)                 GPIO_CONCAT(GPIO_PORT_REG_,port_id)
+#define GPIO_DDR_REG(port_id)                  GPIO_CONCAT(GPIO_DDR_REG_,port_id)
+#define GPIO_PIN_REG(port_id)                  GPIO_CONCAT(GPIO_PIN_REG_,port_id)
+
+#define GPIO_PORT_REG_0                        PORTA
+#define GPIO_PORT_REG_1                        PORTB
+#define GPIO_PORT_REG_2                        PORTC
+#define GPIO_PORT_REG_3                        PORTD
+
+#define GPIO_DDR_REG_0                         DDRA
+#define GPIO_DDR_REG_1                         DDRB
+#define GPIO_DDR_REG_2                         DDRC
+#define GPIO_DDR_REG_3                         DDRD
+
+#define GPIO_PIN_REG_0                         PINA
+#define GPIO_PIN_REG_1                         PINB
+#define GPIO_PIN_REG_2                         PINC
+#define GPIO_PIN_REG_3                         PIND
+
+#define GPIO_SETUP_PIN_OUTPUT(port_id,pin_id)  (GPIO_DDR_REG(port_id) |= (1<<(pin_id)))
+#define GPIO_SETUP_PIN_INPUT(port_id,pin_id)   (GPIO_DDR_REG(port_id) &= ~(1<<(pin_id)))
+#define GPIO_SET_PIN(port_id,pin_id)           (GPIO_PORT_REG(port_id) |= (1<<(pin_id)))
+#define GPIO_CLEAR_PIN(port_id,pin_id)         (GPIO_PORT_REG(port_id) &= ~(1<<(pin_id)))
+#define GPIO_READ_PIN(port_id,pin_id)          ((GPIO_PIN_REG(port_id) & (1<<(pin_id))) ? LOGIC_HIGH : LOGIC_LOW)
+
+#define GPIO_SETUP_PORT_DIRECTION(port_id,direction)  (GPIO_DDR_REG(port_id) = (direction))
+#define GPIO_WRITE_PORT(port_id,value)         (GPIO_PORT_REG(port_id) = (value))
+#define GPIO_READ_PORT(port_id)                (GPIO_PIN_REG(port_id))
+
+/*
+ * Masked access: only the pins in mask are changed, together in one read-modify-write
+ * with the interrupts masked so no pin is seen in a middle state and an interrupt that
+ * writes the same port can't be lost. The read gives all the pins at the same time.
+ */
+#define GPIO_WRITE_REG_MASKED(reg,mask,value)  \
+	do{ \
+		uint8 gpio_sreg = SREG; \
+		cli(); \
+		(reg) = ((reg) & (uint8)~(mask)) | ((value) & (mask)); \
+		SREG = gpio_sreg; \
+	}while(0)
+
+#define GPIO_WRITE_PORT_MASKED(port_id,mask,value)             GPIO_WRITE_REG_MASKED(GPIO_PORT_REG(port_id),mask,value)
+#define GPIO_SETUP_PORT_DIRECTION_MASKED(port_id,mask,direction) GPIO_WRITE_REG_MASKED(GPIO_DDR_REG(port_id),mask,direction)
+#define GPIO_READ_PORT_MASKED(port_id,mask)    (GPIO_PIN_REG(port_id) & (mask))
+
 /*******************************************************************************
  *                               Types Declaration                             *
  *******************************************************************************/
@@ -99,4 +157,20 @@ void GPIO_writePort(uint8 port_num, uint8 value);
  */
 uint8 GPIO_readPort(uint8 port_num);
 
+/*
+ * Description :
+ * Write the bits of value selected by mask on the required port, the other pins are not changed.
+ * The pins are changed together in one read-modify-write with the interrupts masked.
+ * If the input port number is not correct, The function will not handle the request.
+ */
+void GPIO_writePortMasked(uint8 port_num, uint8 mask, uint8 value);
+
+/*
+ * Description :
+ * Read and return the value of the pins selected by mask in the required port, the other bits are zero.
+ * All the pins are read at the same time.
+ * If the input port number is not correct, The function will return ZERO value.
+ */
+uint8 GPIO_readPortMasked(uint8 port_num, uint8 mask);
+
 #endif /* GPIO_H_ */
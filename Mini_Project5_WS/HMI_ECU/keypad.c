@@ -11,138 +11,343 @@
  *******************************************************************************/
 #include "keypad.h"
 #include "gpio.h"
+#include <util/delay.h> /* For the settle time of the column */
+#include <avr/pgmspace.h> /* To read the buttons table from the flash */
+#if (KEYPAD_WAKE_INTERRUPT != KEYPAD_WAKE_NONE)
+#include <avr/io.h> /* To use the external interrupts registers */
+#include <avr/interrupt.h> /* For the external interrupt ISR */
+#endif
 
 /*******************************************************************************
- *                      Functions Prototypes(Private)                          *
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Debounced state of a button in its debounce byte, the other bits count the scans that differ from it */
+#define KEYPAD_DEBOUNCED_PRESSED         0x80
+#define KEYPAD_DEBOUNCE_COUNT_MASK       0x7F
+
+/* Pin, registers and edge of the external interrupt of the wake profile */
+#if (KEYPAD_WAKE_INTERRUPT == KEYPAD_WAKE_INT0)
+#define KEYPAD_WAKE_PORT_ID              PORTD_ID
+#define KEYPAD_WAKE_PIN_ID               PIN2_ID
+#define KEYPAD_WAKE_VECTOR               INT0_vect
+#define KEYPAD_WAKE_ENABLE_BIT           INT0
+#define KEYPAD_WAKE_FLAG_BIT             INTF0
+#define KEYPAD_WAKE_SENSE_REG            MCUCR
+#define KEYPAD_WAKE_SENSE_MASK           ((1<<ISC01) | (1<<ISC00))
+#define KEYPAD_WAKE_SENSE_FALLING        (1<<ISC01)
+#define KEYPAD_WAKE_SENSE_RISING         ((1<<ISC01) | (1<<ISC00))
+#elif (KEYPAD_WAKE_INTERRUPT == KEYPAD_WAKE_INT1)
+#define KEYPAD_WAKE_PORT_ID              PORTD_ID
+#define KEYPAD_WAKE_PIN_ID               PIN3_ID
+#define KEYPAD_WAKE_VECTOR               INT1_vect
+#define KEYPAD_WAKE_ENABLE_BIT           INT1
+#define KEYPAD_WAKE_FLAG_BIT             INTF1
+#define KEYPAD_WAKE_SENSE_REG            MCUCR
+#define KEYPAD_WAKE_SENSE_MASK           ((1<<ISC11) | (1<<ISC10))
+#define KEYPAD_WAKE_SENSE_FALLING        (1<<ISC11)
+#define KEYPAD_WAKE_SENSE_RISING         ((1<<ISC11) | (1<<ISC10))
+#elif (KEYPAD_WAKE_INTERRUPT == KEYPAD_WAKE_INT2)
+#define KEYPAD_WAKE_PORT_ID              PORTB_ID
+#define KEYPAD_WAKE_PIN_ID               PIN2_ID
+#define KEYPAD_WAKE_VECTOR               INT2_vect
+#define KEYPAD_WAKE_ENABLE_BIT           INT2
+#define KEYPAD_WAKE_FLAG_BIT             INTF2
+#define KEYPAD_WAKE_SENSE_REG            MCUCSR
+#define KEYPAD_WAKE_SENSE_MASK           (1<<ISC2)
+#define KEYPAD_WAKE_SENSE_FALLING        0
+#define KEYPAD_WAKE_SENSE_RISING         (1<<ISC2)
+#endif
+
+#if (KEYPAD_WAKE_INTERRUPT != KEYPAD_WAKE_NONE) && (KEYPAD_WAKE_PORT_ID == KEYPAD_PORT_ID) && \
+	(KEYPAD_PINS_MASK & (1<<KEYPAD_WAKE_PIN_ID))
+#error "The keypad wake interrupt pin must not be one of the keypad pins"
+#endif
+
+/*******************************************************************************
+ *                           Global Variables                                  *
  *******************************************************************************/
 
 #if (KEYPAD_NUM_COLS == 3)
-/*
- * Function responsible for mapping the switch number in the keypad to
- * its corresponding functional number in the proteus for 4x3 keypad
- */
-static uint8 KEYPAD_4x3_adjustKeyNumber(uint8 button_number);
+/* Value of each button of the 4x3 keypad in the proteus, by row and column */
+static const uint8 g_keys[KEYPAD_NUM_ROWS][KEYPAD_NUM_COLS] PROGMEM =
+{
+	{ 1   , 2 , 3   },
+	{ 4   , 5 , 6   },
+	{ 7   , 8 , 9   },
+	{ '*' , 0 , '#' }  /* ASCII Codes of * and # */
+};
 #elif (KEYPAD_NUM_COLS == 4)
+/* Value of each button of the 4x4 keypad in the proteus, by row and column */
+static const uint8 g_keys[KEYPAD_NUM_ROWS][KEYPAD_NUM_COLS] PROGMEM =
+{
+	{ 7  , 8 , 9   , '%' },
+	{ 4  , 5 , 6   , '*' },
+	{ 1  , 2 , 3   , '-' },
+	{ 13 , 0 , '=' , '+' }  /* 13 is the ASCII of Enter */
+};
+#endif
+
+/* Debounce state of each button, indexed by row * KEYPAD_NUM_COLS + column */
+static uint8 g_debounce[KEYPAD_NUM_ROWS * KEYPAD_NUM_COLS];
+
 /*
- * Function responsible for mapping the switch number in the keypad to
- * its corresponding functional number in the proteus for 4x4 keypad
+ * FIFO of the button events, written by KEYPAD_tick and read by KEYPAD_getEvent only,
+ * the indices are free running and masked by the FIFO size on access
  */
-static uint8 KEYPAD_4x4_adjustKeyNumber(uint8 button_number);
+static Keypad_Event g_events[KEYPAD_EVENTS_FIFO_SIZE];
+static volatile uint8 g_eventsHead = 0;
+static volatile uint8 g_eventsTail = 0;
+
+#if (KEYPAD_WAKE_INTERRUPT != KEYPAD_WAKE_NONE)
+/* Global variable to hold the address of the call back function of the wake interrupt */
+static void (*volatile g_wakeCallBackPtr)(void) = NULL_PTR;
+#endif
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Drive one column and read all the rows, the pressed rows are ones starting from bit 0 */
+static uint8 KEYPAD_readColumn(uint8 col);
+
+/* Read all the rows at the same time, the pressed rows are ones starting from bit 0 */
+static uint8 KEYPAD_readRows(void);
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+#if (KEYPAD_WAKE_INTERRUPT != KEYPAD_WAKE_NONE)
+ISR(KEYPAD_WAKE_VECTOR)
+{
+	/* The scans take over the keypad pins until all the buttons are released */
+	GICR &= ~(1<<KEYPAD_WAKE_ENABLE_BIT);
+	if(g_wakeCallBackPtr != NULL_PTR)
+	{
+		/* Call the Call Back function in the application after the key press */
+		(*g_wakeCallBackPtr)();
+	}
+}
 #endif
 
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
+
+/*
+ * Description :
+ * Scan the keypad once without waiting
+ * Returns the pressed button or KEYPAD_NO_KEY if no button is pressed
+ */
+uint8 KEYPAD_scanKey(void)
+{
+	uint8 col,row;
+	uint8 pressed_rows;
+	for(col=0;col<KEYPAD_NUM_COLS;col++) /* loop for columns */
+	{
+		pressed_rows = KEYPAD_readColumn(col);
+
+		for(row=0;row<KEYPAD_NUM_ROWS;row++) /* loop for rows */
+		{
+			/* Check if the switch is pressed in this row */
+			if(pressed_rows & (1<<row))
+			{
+				return pgm_read_byte(&g_keys[row][col]);
+			}
+		}
+	}
+	return KEYPAD_NO_KEY;
+}
+
+/*
+ * Description :
+ * Wait until a button is pressed and return it
+ */
 uint8 KEYPAD_getPressedKey(void)
+{
+	uint8 key;
+	do
+	{
+		key = KEYPAD_scanKey();
+	}while(key == KEYPAD_NO_KEY);
+	return key;
+}
+
+/*
+ * Description :
+ * Scan all the buttons once, to be called periodically from a timer.
+ * Each button is debounced alone and an event is added to the FIFO when it is
+ * pressed or released, the event is dropped if the FIFO is full.
+ */
+void KEYPAD_tick(void)
 {
 	uint8 col,row;
-	uint8 keypad_port_value = 0;
-	while(1)
+	uint8 pressed_rows;
+	uint8 button;
+	uint8 *debounce;
+	boolean pressed;
+
+	for(col=0;col<KEYPAD_NUM_COLS;col++) /* loop for columns */
 	{
-		for(col=0;col<KEYPAD_NUM_COLS;col++) /* loop for columns */
+		pressed_rows = KEYPAD_readColumn(col);
+
+		for(row=0;row<KEYPAD_NUM_ROWS;row++) /* loop for rows */
 		{
-			/* 
-			 * Each time setup the direction for all keypad port as input pins,
-			 * except this column will be output pin
-			 */
-			GPIO_setupPortDirection(KEYPAD_PORT_ID,PORT_INPUT);
-			GPIO_setupPinDirection(KEYPAD_PORT_ID,KEYPAD_FIRST_COLUMN_PIN_ID+col,PIN_OUTPUT);
-			
-#if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
-			/* Clear the column output pin and set the rest pins value */
-			keypad_port_value = ~(1<<(KEYPAD_FIRST_COLUMN_PIN_ID+col));
-#else
-			/* Set the column output pin and clear the rest pins value */
-			keypad_port_value = (1<<(KEYPAD_FIRST_COLUMN_PIN_ID+col));
-#endif
-			GPIO_writePort(KEYPAD_PORT_ID,keypad_port_value);
+			button = (row*KEYPAD_NUM_COLS)+col;
+			debounce = &g_debounce[button];
+			pressed = (pressed_rows & (1<<row)) ? TRUE : FALSE;
 
-			for(row=0;row<KEYPAD_NUM_ROWS;row++) /* loop for rows */
+			if(pressed == ((*debounce & KEYPAD_DEBOUNCED_PRESSED) ? TRUE : FALSE))
+			{
+				/* Same as the debounced state, a bounce is forgotten */
+				*debounce &= KEYPAD_DEBOUNCED_PRESSED;
+				continue;
+			}
+			(*debounce)++;
+			if((*debounce & KEYPAD_DEBOUNCE_COUNT_MASK) < KEYPAD_DEBOUNCE_SCANS)
 			{
-				/* Check if the switch is pressed in this row */
-				if(GPIO_readPin(KEYPAD_PORT_ID,row+KEYPAD_FIRST_ROW_PIN_ID) == KEYPAD_BUTTON_PRESSED)
-				{
-					#if (KEYPAD_NUM_COLS == 3)
-						return KEYPAD_4x3_adjustKeyNumber((row*KEYPAD_NUM_COLS)+col+1);
-					#elif (KEYPAD_NUM_COLS == 4)
-						return KEYPAD_4x4_adjustKeyNumber((row*KEYPAD_NUM_COLS)+col+1);
-					#endif
-				}
+				continue;
+			}
+
+			/* The change stayed for the debounce time, taking it */
+			*debounce = pressed ? KEYPAD_DEBOUNCED_PRESSED : 0;
+			if((uint8)(g_eventsHead - g_eventsTail) < KEYPAD_EVENTS_FIFO_SIZE)
+			{
+				g_events[g_eventsHead & (KEYPAD_EVENTS_FIFO_SIZE - 1)].key = pgm_read_byte(&g_keys[row][col]);
+				g_events[g_eventsHead & (KEYPAD_EVENTS_FIFO_SIZE - 1)].type =
+						pressed ? KEYPAD_KEY_PRESSED : KEYPAD_KEY_RELEASED;
+				g_eventsHead++;
 			}
 		}
-	}	
+	}
 }
 
-#if (KEYPAD_NUM_COLS == 3)
+/*
+ * Description :
+ * Take the oldest button event found by KEYPAD_tick
+ * Returns FALSE if there is no event
+ */
+boolean KEYPAD_getEvent(Keypad_Event *event)
+{
+	if(g_eventsHead == g_eventsTail)
+	{
+		return FALSE;
+	}
+	*event = g_events[g_eventsTail & (KEYPAD_EVENTS_FIFO_SIZE - 1)];
+	g_eventsTail++;
+	return TRUE;
+}
 
 /*
  * Description :
- * Update the keypad pressed button value with the correct one in keypad 4x3 shape
+ * Returns TRUE if all the buttons are released and none of them is bouncing,
+ * so KEYPAD_tick has nothing to find until the next press
  */
-static uint8 KEYPAD_4x3_adjustKeyNumber(uint8 button_number)
+boolean KEYPAD_isIdle(void)
 {
-	uint8 keypad_button = 0;
-	switch(button_number)
+	uint8 button;
+
+	for(button = 0; button < (KEYPAD_NUM_ROWS * KEYPAD_NUM_COLS); button++)
 	{
-		case 10: keypad_button = '*'; // ASCII Code of *
-				 break;
-		case 11: keypad_button = 0;
-				 break;		
-		case 12: keypad_button = '#'; // ASCII Code of #
-				 break;
-		default: keypad_button = button_number;
-				break;
+		if(g_debounce[button] != 0)
+		{
+			return FALSE;
+		}
 	}
-	return keypad_button;
-} 
+	return TRUE;
+}
 
-#elif (KEYPAD_NUM_COLS == 4)
+#if (KEYPAD_WAKE_INTERRUPT != KEYPAD_WAKE_NONE)
+/*
+ * Description :
+ * Set the function called from the external interrupt when a button is pressed
+ * after KEYPAD_enableWake, it runs in interrupt context so it must be short
+ */
+void KEYPAD_setWakeCallBack(void(*a_ptr)(void))
+{
+	g_wakeCallBackPtr = a_ptr;
+}
 
 /*
  * Description :
- * Update the keypad pressed button value with the correct one in keypad 4x4 shape
+ * Drive all the columns active and enable the external interrupt of the wake profile,
+ * the interrupt is disabled again when it is raised so the scans can use the pins.
+ * Returns FALSE without enabling it if a button is already pressed, the press would
+ * not raise the interrupt so the caller must go on scanning.
  */
-static uint8 KEYPAD_4x4_adjustKeyNumber(uint8 button_number)
+boolean KEYPAD_enableWake(void)
 {
-	uint8 keypad_button = 0;
-	switch(button_number)
+	/* All the columns are outputs and the rows are inputs, the other pins of the port are not changed */
+	GPIO_SETUP_PORT_DIRECTION_MASKED(KEYPAD_PORT_ID,KEYPAD_PINS_MASK,KEYPAD_COLUMNS_MASK);
+	GPIO_SETUP_PIN_INPUT(KEYPAD_WAKE_PORT_ID,KEYPAD_WAKE_PIN_ID);
+
+#if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
+	/* Clear all the columns and pull up the rows and the interrupt pin, a press makes a falling edge */
+	GPIO_WRITE_PORT_MASKED(KEYPAD_PORT_ID,KEYPAD_PINS_MASK,KEYPAD_ROWS_MASK);
+	GPIO_SET_PIN(KEYPAD_WAKE_PORT_ID,KEYPAD_WAKE_PIN_ID);
+	GPIO_WRITE_REG_MASKED(KEYPAD_WAKE_SENSE_REG,KEYPAD_WAKE_SENSE_MASK,KEYPAD_WAKE_SENSE_FALLING);
+#else
+	/* Set all the columns, the interrupt pin is pulled down outside so a press makes a rising edge */
+	GPIO_WRITE_PORT_MASKED(KEYPAD_PORT_ID,KEYPAD_PINS_MASK,KEYPAD_COLUMNS_MASK);
+	GPIO_CLEAR_PIN(KEYPAD_WAKE_PORT_ID,KEYPAD_WAKE_PIN_ID);
+	GPIO_WRITE_REG_MASKED(KEYPAD_WAKE_SENSE_REG,KEYPAD_WAKE_SENSE_MASK,KEYPAD_WAKE_SENSE_RISING);
+#endif
+	/* Let the columns settle through the keypad lines before reading the rows */
+	_delay_us(1);
+
+	if(KEYPAD_readRows() != 0)
 	{
-		case 1: keypad_button = 7;
-				break;
-		case 2: keypad_button = 8;
-				break;
-		case 3: keypad_button = 9;
-				break;
-		case 4: keypad_button = '%'; // ASCII Code of %
-				break;
-		case 5: keypad_button = 4;
-				break;
-		case 6: keypad_button = 5;
-				break;
-		case 7: keypad_button = 6;
-				break;
-		case 8: keypad_button = '*'; /* ASCII Code of '*' */
-				break;		
-		case 9: keypad_button = 1;
-				break;
-		case 10: keypad_button = 2;
-				break;
-		case 11: keypad_button = 3;
-				break;
-		case 12: keypad_button = '-'; /* ASCII Code of '-' */
-				break;
-		case 13: keypad_button = 13;  /* ASCII of Enter */
-				break;			
-		case 14: keypad_button = 0;
-				break;
-		case 15: keypad_button = '='; /* ASCII Code of '=' */
-				break;
-		case 16: keypad_button = '+'; /* ASCII Code of '+' */
-				break;
-		default: keypad_button = button_number;
-				break;
+		return FALSE;
 	}
-	return keypad_button;
-} 
 
+	/* Clearing an edge made while the pins were changed, then enabling the interrupt */
+	GIFR = (1<<KEYPAD_WAKE_FLAG_BIT);
+	GICR |= (1<<KEYPAD_WAKE_ENABLE_BIT);
+	return TRUE;
+}
 #endif
+
+/*
+ * Description :
+ * Drive one column and read all the rows, the pressed rows are ones starting from bit 0
+ */
+static uint8 KEYPAD_readColumn(uint8 col)
+{
+	uint8 column_pin = (1<<(KEYPAD_FIRST_COLUMN_PIN_ID+col));
+
+	/*
+	 * Each time setup the direction for all keypad pins as input pins,
+	 * except this column will be output pin, the other pins of the port are not changed
+	 */
+	GPIO_SETUP_PORT_DIRECTION_MASKED(KEYPAD_PORT_ID,KEYPAD_PINS_MASK,column_pin);
+
+#if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
+	/* Clear the column output pin and set the rest keypad pins value */
+	GPIO_WRITE_PORT_MASKED(KEYPAD_PORT_ID,KEYPAD_PINS_MASK,(uint8)~column_pin);
+#else
+	/* Set the column output pin and clear the rest keypad pins value */
+	GPIO_WRITE_PORT_MASKED(KEYPAD_PORT_ID,KEYPAD_PINS_MASK,column_pin);
+#endif
+	/* Let the column settle through the keypad lines before reading the rows */
+	_delay_us(1);
+
+	return KEYPAD_readRows();
+}
+
+/*
+ * Description :
+ * Read all the rows at the same time, the pressed rows are ones starting from bit 0
+ */
+static uint8 KEYPAD_readRows(void)
+{
+	uint8 pressed_rows;
+
+#if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
+	pressed_rows = (uint8)~GPIO_READ_PORT_MASKED(KEYPAD_PORT_ID,KEYPAD_ROWS_MASK) & KEYPAD_ROWS_MASK;
+#else
+	pressed_rows = GPIO_READ_PORT_MASKED(KEYPAD_PORT_ID,KEYPAD_ROWS_MASK);
+#endif
+	return (pressed_rows >> KEYPAD_FIRST_ROW_PIN_ID);
+}
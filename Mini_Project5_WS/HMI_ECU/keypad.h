@@ -29,18 +29,108 @@
 #define KEYPAD_FIRST_ROW_PIN_ID           PIN0_ID
 #define KEYPAD_FIRST_COLUMN_PIN_ID        PIN4_ID
 
+/*
+ * Wake on key press wiring profile, with KEYPAD_WAKE_NONE the keypad must be scanned all the time.
+ * With an external interrupt all the columns are driven active between the scans and the rows
+ * are joined by diodes to the interrupt pin (INT0 on PD2, INT1 on PD3 or INT2 on PB2), so any
+ * press raises the interrupt. The interrupt pin must not be one of the keypad pins.
+ */
+#define KEYPAD_WAKE_NONE                 0
+#define KEYPAD_WAKE_INT0                 1
+#define KEYPAD_WAKE_INT1                 2
+#define KEYPAD_WAKE_INT2                 3
+
+#define KEYPAD_WAKE_INTERRUPT            KEYPAD_WAKE_NONE
+
+/* Keypad pins in the port, the other pins of the port are not changed by the scan */
+#define KEYPAD_ROWS_MASK                 (((1<<KEYPAD_NUM_ROWS) - 1) << KEYPAD_FIRST_ROW_PIN_ID)
+#define KEYPAD_COLUMNS_MASK              (((1<<KEYPAD_NUM_COLS) - 1) << KEYPAD_FIRST_COLUMN_PIN_ID)
+#define KEYPAD_PINS_MASK                 (KEYPAD_ROWS_MASK | KEYPAD_COLUMNS_MASK)
+
 /* Keypad button logic configurations */
 #define KEYPAD_BUTTON_PRESSED            LOGIC_LOW
 #define KEYPAD_BUTTON_RELEASED           LOGIC_HIGH
 
+/* Returned by KEYPAD_scanKey when no button is pressed, no button has this value */
+#define KEYPAD_NO_KEY                    0xFF
+
+/* A button change is taken by KEYPAD_tick when it is seen in this number of scans in a row */
+#define KEYPAD_DEBOUNCE_SCANS            4
+
+/* Number of button events kept until they are read, must be a power of 2 */
+#define KEYPAD_EVENTS_FIFO_SIZE          16
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+typedef enum
+{
+	KEYPAD_KEY_PRESSED , KEYPAD_KEY_RELEASED
+}Keypad_EventType;
+
+/* Button pressed or released, found by KEYPAD_tick */
+typedef struct
+{
+	uint8 key;
+	Keypad_EventType type;
+}Keypad_Event;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 /*
  * Description :
- * Get the Keypad pressed button
+ * Scan the keypad once without waiting
+ * Returns the pressed button or KEYPAD_NO_KEY if no button is pressed
+ */
+uint8 KEYPAD_scanKey(void);
+
+/*
+ * Description :
+ * Get the Keypad pressed button, waits until a button is pressed
  */
 uint8 KEYPAD_getPressedKey(void);
 
+/*
+ * Description :
+ * Scan all the buttons once, to be called periodically from a timer.
+ * Each button is debounced alone and an event is added to the FIFO when it is
+ * pressed or released, the event is dropped if the FIFO is full.
+ */
+void KEYPAD_tick(void);
+
+/*
+ * Description :
+ * Take the oldest button event found by KEYPAD_tick
+ * Returns FALSE if there is no event
+ */
+boolean KEYPAD_getEvent(Keypad_Event *event);
+
+/*
+ * Description :
+ * Returns TRUE if all the buttons are released and none of them is bouncing,
+ * so KEYPAD_tick has nothing to find until the next press
+ */
+boolean KEYPAD_isIdle(void);
+
+#if (KEYPAD_WAKE_INTERRUPT != KEYPAD_WAKE_NONE)
+/*
+ * Description :
+ * Set the function called from the external interrupt when a button is pressed
+ * after KEYPAD_enableWake, it runs in interrupt context so it must be short
+ */
+void KEYPAD_setWakeCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Drive all the columns active and enable the external interrupt of the wake profile,
+ * the interrupt is disabled again when it is raised so the scans can use the pins.
+ * Returns FALSE without enabling it if a button is already pressed, the press would
+ * not raise the interrupt so the caller must go on scanning.
+ */
+boolean KEYPAD_enableWake(void);
+#endif
+
 #endif /* KEYPAD_H_ */
@@ -11,10 +11,48 @@
  *******************************************************************************/
 
 #include <util/delay.h> /* For the delay functions */
+#include <avr/pgmspace.h> /* To read the strings stored in the flash */
 #include "common_macros.h" /* To use the macros like SET_BIT */
 #include "lcd.h"
 #include "gpio.h"
 
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* RAM shadow of the screen written by the LCD_frame functions */
+static uint8 g_frame[LCD_FRAME_ROWS][LCD_FRAME_COLS];
+
+/* What the screen shows now, the cells that are different from the shadow are waiting to be sent */
+static uint8 g_frameShown[LCD_FRAME_ROWS][LCD_FRAME_COLS];
+
+/* Cell where LCD_frameStep looks for the next different cell */
+static uint8 g_stepRow = 0;
+static uint8 g_stepCol = 0;
+
+/*
+ * Address of the LCD cursor, not known after it goes out of a row, LCD_sendCommand and
+ * LCD_displayCharacter clear g_cursorKnown so any direct use of the LCD functions does
+ */
+static uint8 g_cursorRow = 0;
+static uint8 g_cursorCol = 0;
+static boolean g_cursorKnown = FALSE;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Fill the shadow and the shown copy with spaces like a cleared screen */
+static void LCD_frameReset(void);
+
+/* Write an instruction (RS=0) or data (RS=1) byte and wait until the LCD can take the next one */
+static void LCD_write(uint8 rs_value, uint8 value, uint16 execution_time_us);
+
+#if (LCD_USE_BUSY_FLAG == TRUE)
+/* Read the busy flag until it is cleared, returns FALSE if it stayed set for execution_time_us */
+static boolean LCD_waitBusyFlag(uint16 execution_time_us);
+#endif
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -28,18 +66,20 @@
 void LCD_init(void)
 {
 	/* Configure the direction for RS, RW and E pins as output pins */
-	GPIO_setupPinDirection(LCD_RS_PORT_ID,LCD_RS_PIN_ID,PIN_OUTPUT);
-	GPIO_setupPinDirection(LCD_RW_PORT_ID,LCD_RW_PIN_ID,PIN_OUTPUT);
-	GPIO_setupPinDirection(LCD_E_PORT_ID,LCD_E_PIN_ID,PIN_OUTPUT);
+	GPIO_SETUP_PORT_DIRECTION_MASKED(LCD_CTRL_PORT_ID,LCD_CTRL_PINS_MASK,LCD_CTRL_PINS_MASK);
 
 	/* Configure the data port as output port */
-	GPIO_setupPortDirection(LCD_DATA_PORT_ID,PORT_OUTPUT);
+	GPIO_SETUP_PORT_DIRECTION(LCD_DATA_PORT_ID,PORT_OUTPUT);
+
+	/* The LCD can't take instructions or give the busy flag until its power on reset is done */
+	_delay_ms(LCD_POWER_ON_DELAY_MS);
 
 	LCD_sendCommand(LCD_TWO_LINES_EIGHT_BITS_MODE); /* use 2-line lcd + 8-bit Data Mode + 5*7 dot display Mode */
 	
 	LCD_sendCommand(LCD_CURSOR_OFF); /* cursor off */
 	
 	LCD_sendCommand(LCD_CLEAR_COMMAND); /* clear LCD at the beginning */
+	LCD_frameReset();
 }
 
 /*
@@ -48,15 +88,18 @@ void LCD_init(void)
  */
 void LCD_sendCommand(uint8 command)
 {
-	GPIO_writePin(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_LOW); /* Instruction Mode RS=0 */
-	GPIO_writePin(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_LOW); /* write data to LCD so RW=0 */
-	_delay_ms(1); /* delay for processing Tas = 50ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
-	GPIO_writePort(LCD_DATA_PORT_ID,command); /* out the required command to the data bus D0 --> D7 */
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+	/* The command may move the cursor, the frame functions set the address again after it */
+	g_cursorKnown = FALSE;
+
+	/* Clear (0x01) and return home (0x02, 0x03) are the slow instructions */
+	if((command & 0xFC) == 0)
+	{
+		LCD_write(0, command, LCD_LONG_EXECUTION_TIME_US); /* Instruction Mode RS=0 */
+	}
+	else
+	{
+		LCD_write(0, command, LCD_EXECUTION_TIME_US); /* Instruction Mode RS=0 */
+	}
 }
 
 /*
@@ -65,17 +108,72 @@ void LCD_sendCommand(uint8 command)
  */
 void LCD_displayCharacter(uint8 data)
 {
-	GPIO_writePin(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_HIGH); /* Data Mode RS=1 */
-	GPIO_writePin(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_LOW); /* write data to LCD so RW=0 */
-	_delay_ms(1); /* delay for processing Tas = 50ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
-	GPIO_writePort(LCD_DATA_PORT_ID,data); /* out the required command to the data bus D0 --> D7 */
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+	/* Written from outside the frame functions, the cursor is not tracked */
+	g_cursorKnown = FALSE;
+	LCD_write((1<<LCD_RS_PIN_ID), data, LCD_EXECUTION_TIME_US); /* Data Mode RS=1 */
+}
+
+/*
+ * Description :
+ * Write an instruction (RS=0) or data (RS=1) byte and wait until the LCD can take the next one
+ * The pulse times are in ns so 1 us covers each of them
+ */
+static void LCD_write(uint8 rs_value, uint8 value, uint16 execution_time_us)
+{
+	GPIO_WRITE_PORT_MASKED(LCD_CTRL_PORT_ID,LCD_RS_RW_MASK,rs_value); /* RS as required and write data to LCD so RW=0 */
+	_delay_us(1); /* delay for processing Tas = 50ns */
+	GPIO_SET_PIN(LCD_E_PORT_ID,LCD_E_PIN_ID); /* Enable LCD E=1 */
+	GPIO_WRITE_PORT(LCD_DATA_PORT_ID,value); /* out the required byte to the data bus D0 --> D7 */
+	_delay_us(1); /* delay for processing Tpw = 230ns and Tdsw = 80ns */
+	GPIO_CLEAR_PIN(LCD_E_PORT_ID,LCD_E_PIN_ID); /* Disable LCD E=0 */
+	_delay_us(1); /* delay for processing Th = 10ns and the E cycle = 500ns */
+
+#if (LCD_USE_BUSY_FLAG == TRUE)
+	if(LCD_waitBusyFlag(execution_time_us))
+	{
+		return;
+	}
+	/* The busy flag didn't clear in time so the worst case time is taken */
+#endif
+	while(execution_time_us >= LCD_EXECUTION_TIME_US)
+	{
+		_delay_us(LCD_EXECUTION_TIME_US);
+		execution_time_us -= LCD_EXECUTION_TIME_US;
+	}
 }
 
+#if (LCD_USE_BUSY_FLAG == TRUE)
+/*
+ * Description :
+ * Read the busy flag until it is cleared
+ * Returns FALSE if it stayed set for execution_time_us, the data port is an output again on return
+ */
+static boolean LCD_waitBusyFlag(uint16 execution_time_us)
+{
+	uint8 busy;
+	/* Every read takes at least 2 us */
+	uint16 reads = (execution_time_us / 2) + 1;
+
+	/* The LCD drives the data bus while it is read */
+	GPIO_SETUP_PORT_DIRECTION(LCD_DATA_PORT_ID,PORT_INPUT);
+	GPIO_WRITE_PORT_MASKED(LCD_CTRL_PORT_ID,LCD_RS_RW_MASK,(1<<LCD_RW_PIN_ID)); /* Instruction Mode RS=0 and read from LCD so RW=1 */
+	do
+	{
+		_delay_us(1); /* delay for processing Tas = 40ns and the E cycle = 500ns */
+		GPIO_SET_PIN(LCD_E_PORT_ID,LCD_E_PIN_ID); /* Enable LCD E=1 */
+		_delay_us(1); /* delay for processing Tddr = 160ns */
+		busy = GPIO_READ_PIN(LCD_DATA_PORT_ID,LCD_BUSY_FLAG_PIN_ID);
+		GPIO_CLEAR_PIN(LCD_E_PORT_ID,LCD_E_PIN_ID); /* Disable LCD E=0 */
+		reads--;
+	}while((busy == LOGIC_HIGH) && (reads != 0));
+
+	GPIO_WRITE_PORT_MASKED(LCD_CTRL_PORT_ID,LCD_RS_RW_MASK,0); /* Back to write RW=0 before the bus is driven */
+	GPIO_SETUP_PORT_DIRECTION(LCD_DATA_PORT_ID,PORT_OUTPUT);
+
+	return (busy == LOGIC_LOW);
+}
+#endif
+
 /*
  * Description :
  * Display the required string on the screen
@@ -97,6 +195,21 @@ void LCD_displayString(const char *Str)
 	*********************************************************/
 }
 
+/*
+ * Description :
+ * Display the required string stored in the flash (PROGMEM) on the screen
+ */
+void LCD_displayString_P(const char *Str)
+{
+	uint8 character;
+
+	while((character = pgm_read_byte(Str)) != '\0')
+	{
+		LCD_displayCharacter(character);
+		Str++;
+	}
+}
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
@@ -154,3 +267,176 @@ void LCD_clearScreen(void)
 {
 	LCD_sendCommand(LCD_CLEAR_COMMAND); /* Send clear display command */
 }
+
+/*
+ * Description :
+ * Fill the RAM shadow of the screen with spaces, nothing is sent until LCD_frameStep or LCD_frameFlush
+ */
+void LCD_frameClear(void)
+{
+	uint8 row,col;
+	for(row = 0; row < LCD_FRAME_ROWS; row++)
+	{
+		for(col = 0; col < LCD_FRAME_COLS; col++)
+		{
+			g_frame[row][col] = ' ';
+		}
+	}
+}
+
+/*
+ * Description :
+ * Write the string in the RAM shadow of the screen at the row and column,
+ * the part out of the row is cut, nothing is sent until LCD_frameStep or LCD_frameFlush
+ */
+void LCD_frameString(uint8 row,uint8 col,const char *Str)
+{
+	if(row >= LCD_FRAME_ROWS)
+	{
+		return;
+	}
+	while((*Str != '\0') && (col < LCD_FRAME_COLS))
+	{
+		g_frame[row][col] = *Str;
+		col++;
+		Str++;
+	}
+}
+
+/*
+ * Description :
+ * Same as LCD_frameString for a string stored in the flash (PROGMEM)
+ */
+void LCD_frameString_P(uint8 row,uint8 col,const char *Str)
+{
+	uint8 character;
+
+	if(row >= LCD_FRAME_ROWS)
+	{
+		return;
+	}
+	while(((character = pgm_read_byte(Str)) != '\0') && (col < LCD_FRAME_COLS))
+	{
+		g_frame[row][col] = character;
+		col++;
+		Str++;
+	}
+}
+
+/*
+ * Description :
+ * Send one byte of the cells of the RAM shadow that are different from the screen,
+ * a cursor move or a character, so the caller is kept only for one LCD instruction.
+ * The different cells are sent in order with the fewest cursor moves.
+ * Returns FALSE if the screen already shows the RAM shadow and nothing was sent.
+ */
+boolean LCD_frameStep(void)
+{
+	uint8 row = g_stepRow;
+	uint8 col = g_stepCol;
+	uint8 cells;
+
+	/* Looking for the next different cell from where the last step stopped */
+	for(cells = 0; cells < (LCD_FRAME_ROWS * LCD_FRAME_COLS); cells++)
+	{
+		if(g_frame[row][col] != g_frameShown[row][col])
+		{
+			break;
+		}
+		col++;
+		if(col == LCD_FRAME_COLS)
+		{
+			col = 0;
+			row = (row + 1) % LCD_FRAME_ROWS;
+		}
+	}
+	if(cells == (LCD_FRAME_ROWS * LCD_FRAME_COLS))
+	{
+		return FALSE;
+	}
+	g_stepRow = row;
+	g_stepCol = col;
+
+	/* Writing the unchanged cells of a short gap again is not more bytes than a move */
+	if(g_cursorKnown && (row == g_cursorRow) && (col >= g_cursorCol) &&
+			((col - g_cursorCol) <= LCD_FRAME_MAX_GAP))
+	{
+		/* Written directly so the cursor stays tracked */
+		LCD_write((1<<LCD_RS_PIN_ID), g_frame[row][g_cursorCol], LCD_EXECUTION_TIME_US);
+		g_frameShown[row][g_cursorCol] = g_frame[row][g_cursorCol];
+		g_cursorCol++;
+		/* The cursor doesn't go from the end of a row to the next one */
+		if(g_cursorCol == LCD_FRAME_COLS)
+		{
+			g_cursorKnown = FALSE;
+		}
+	}
+	else
+	{
+		LCD_moveCursor(row,col);
+		g_cursorRow = row;
+		g_cursorCol = col;
+		g_cursorKnown = TRUE;
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Wait until all the cells of the RAM shadow that are different from the screen are
+ * sent, for when the screen must be current before going on
+ * Returns the number of bytes sent to the LCD
+ */
+uint8 LCD_frameFlush(void)
+{
+	uint8 sent = 0;
+
+	while(LCD_frameStep())
+	{
+		sent++;
+	}
+	return sent;
+}
+
+/*
+ * Description :
+ * Clear the screen and send the whole RAM shadow, the fallback to use after the
+ * screen was written by the other LCD functions so the screen content is not known
+ * Returns the number of bytes sent to the LCD
+ */
+uint8 LCD_frameRedraw(void)
+{
+	uint8 row,col;
+
+	LCD_clearScreen();
+	/* The screen has only spaces now and the cursor is at the start, known again after the clear */
+	g_cursorRow = 0;
+	g_cursorCol = 0;
+	g_cursorKnown = TRUE;
+	for(row = 0; row < LCD_FRAME_ROWS; row++)
+	{
+		for(col = 0; col < LCD_FRAME_COLS; col++)
+		{
+			g_frameShown[row][col] = ' ';
+		}
+	}
+	return LCD_frameFlush() + 1;
+}
+
+/*
+ * Description :
+ * Fill the shadow and the shown copy with spaces like a cleared screen
+ */
+static void LCD_frameReset(void)
+{
+	uint8 row,col;
+
+	for(row = 0; row < LCD_FRAME_ROWS; row++)
+	{
+		for(col = 0; col < LCD_FRAME_COLS; col++)
+		{
+			g_frame[row][col] = ' ';
+			g_frameShown[row][col] = ' ';
+		}
+	}
+}
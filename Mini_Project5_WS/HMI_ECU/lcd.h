@@ -30,6 +30,43 @@
 
 #define LCD_DATA_PORT_ID               PORTC_ID
 
+/* The control pins are on one port so RS and RW are written together */
+#define LCD_CTRL_PORT_ID               LCD_RS_PORT_ID
+#define LCD_RS_RW_MASK                 ((1<<LCD_RS_PIN_ID) | (1<<LCD_RW_PIN_ID))
+#define LCD_CTRL_PINS_MASK             (LCD_RS_RW_MASK | (1<<LCD_E_PIN_ID))
+
+#if (LCD_RW_PORT_ID != LCD_CTRL_PORT_ID) || (LCD_E_PORT_ID != LCD_CTRL_PORT_ID)
+#error "LCD RS, RW and E pins must be on the same port"
+#endif
+
+/* Data bus pin of the busy flag (DB7) */
+#define LCD_BUSY_FLAG_PIN_ID           PIN7_ID
+
+/*
+ * Waiting for the LCD to finish an instruction:
+ * TRUE : read the busy flag on DB7 through the RW line and go on as soon as it is ready,
+ *        if it stays busy longer than the slowest instruction the worst case time is taken.
+ * FALSE: wait the worst case execution time of every instruction.
+ */
+#define LCD_USE_BUSY_FLAG              TRUE
+
+/* Worst case execution times of HD44780 at 270 kHz with a margin, in us */
+#define LCD_EXECUTION_TIME_US          40     /* Most instructions and data writes take 37 us */
+#define LCD_LONG_EXECUTION_TIME_US     1640   /* Clear and return home take 1.52 ms */
+
+/* Time after power on before the first instruction, in ms */
+#define LCD_POWER_ON_DELAY_MS          15
+
+/*
+ * Size of the RAM shadow of the screen used by the LCD_frame functions.
+ * The cells of the shadow that are different from the screen are sent in the background,
+ * a gap of up to LCD_FRAME_MAX_GAP unchanged cells between two changed cells is written
+ * again because it costs no more bytes than moving the cursor.
+ */
+#define LCD_FRAME_ROWS                 2
+#define LCD_FRAME_COLS                 20
+#define LCD_FRAME_MAX_GAP              1
+
 /* LCD Commands */
 #define LCD_CLEAR_COMMAND              0x01
 #define LCD_GO_TO_HOME                 0x02
@@ -69,6 +106,12 @@ void LCD_displayCharacter(uint8 data);
  */
 void LCD_displayString(const char *Str);
 
+/*
+ * Description :
+ * Display the required string stored in the flash (PROGMEM) on the screen
+ */
+void LCD_displayString_P(const char *Str);
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
@@ -93,4 +136,49 @@ void LCD_intgerToString(int data);
  */
 void LCD_clearScreen(void);
 
+/*
+ * Description :
+ * Fill the RAM shadow of the screen with spaces, nothing is sent until LCD_frameStep
+ * or LCD_frameFlush
+ */
+void LCD_frameClear(void);
+
+/*
+ * Description :
+ * Write the string in the RAM shadow of the screen at the row and column and return,
+ * the part out of the row is cut, nothing is sent until LCD_frameStep or LCD_frameFlush
+ */
+void LCD_frameString(uint8 row,uint8 col,const char *Str);
+
+/*
+ * Description :
+ * Same as LCD_frameString for a string stored in the flash (PROGMEM)
+ */
+void LCD_frameString_P(uint8 row,uint8 col,const char *Str);
+
+/*
+ * Description :
+ * Send one byte of the cells of the RAM shadow that are different from the screen,
+ * a cursor move or a character, so the caller is kept only for one LCD instruction.
+ * The different cells are sent in order with the fewest cursor moves.
+ * Returns FALSE if the screen already shows the RAM shadow and nothing was sent.
+ */
+boolean LCD_frameStep(void);
+
+/*
+ * Description :
+ * Wait until all the cells of the RAM shadow that are different from the screen are
+ * sent, for when the screen must be current before going on
+ * Returns the number of bytes sent to the LCD
+ */
+uint8 LCD_frameFlush(void);
+
+/*
+ * Description :
+ * Clear the screen and send the whole RAM shadow, the fallback to use after the
+ * screen was written by the other LCD functions so the screen content is not known
+ * Returns the number of bytes sent to the LCD
+ */
+uint8 LCD_frameRedraw(void);
+
 #endif /* LCD_H_ */
@@ -10,35 +10,147 @@
  *
  *********************************************************************/
 
-#include "timer0.h"
+#include "systime.h"
+#include "swtimer.h"
+#include "scheduler.h"
 #include "uart.h"
+#include "protocol.h"
 #include "lcd.h"
 #include "keypad.h"
-#include <util/delay.h> /* For the delay functions */
+#include <avr/pgmspace.h>
 
 /*******************************************************************************
  *                      Preprocessor Macros                                    *
  *******************************************************************************/
 
-/* Define Commands in Communication between the two Controllers*/
-#define MISMATCH          0x00  /* Means the password sent doesn't match the one saved in eeprom */
-#define MATCH             0x01  /* Means the password sent matchs the one saved in eeprom */
-#define OPENDOOR          0x02  /* Means the user wants to open the door */
-#define CHANGEPASS        0x03  /* Means the usaer wants to change the saved password */
-#define TRIGGER           0x04  /* Means trigger the buzzer alarm */
-#define READY             0x05  /* Means ready to start the timer to count used for sync */
+/* The keypad is scanned every 5 ms, a key is taken after KEYPAD_DEBOUNCE_SCANS scans */
+#define KEYPAD_SCAN_PERIOD_MS  5
 
-/* Define Time for timer to count by interrupts */
-#define SEC_15            457   /* The number of interrupts needed to count 15 sec */
-#define SEC_18            548   /* The number of interrupts needed to count 15 + 3 sec */
-#define SEC_33            1005  /* The number of interrupts needed to count 15 + 3 + 15 sec */
-#define MINUTE            1828  /* The number of interrupts needed to count 1 min */
+/* The LCD gets one byte of the screen changes every 1 ms while there are changes to send */
+#define LCD_STEP_PERIOD_MS     1
+
+/* Time to ask the Control_ECU for the status again if it doesn't reply at startup */
+#define STATUS_RETRY_MS        200
+
+/* Time to wait for the result of a password check before giving up on the Control_ECU */
+#define VERDICT_TIMEOUT_MS     1000
+
+/* Time to show the wrong password message */
+#define MESSAGE_MS             1000
+
+/* Column of the first * of the password, after "Password: " */
+#define PASSWORD_COLUMN        10
+
+/*
+ * Send each digit of the passwords checked by the Control_ECU as soon as it is typed, so it
+ * is compared while the next one is typed and the result is ready after the last digit
+ */
+#define STREAM_PASSWORD_DIGITS TRUE
+
+/* Key to stop the door while it is moving */
+#define DOOR_STOP_KEY          '*'
+
+/* Number of wrong passwords that trigger the alarm */
+#define MAX_WRONG_TRIALS       3
+
+/* Events of the link task */
+#define LINK_EVENT_RX          0x01  /* Bytes received or the frame timeout passed */
+
+/* Events of the UI task */
+#define UI_EVENT_SCAN          0x01  /* Time to scan the keypad for the key events */
+#define UI_EVENT_VERDICT       0x02  /* The Control_ECU sent the result of a password check */
+#define UI_EVENT_TIMEOUT       0x04  /* The message or the alarm time passed */
+#define UI_EVENT_DOOR_OPEN     0x08  /* The door is open */
+#define UI_EVENT_DOOR_LOCK     0x10  /* The door starts locking */
+#define UI_EVENT_DOOR_CLOSE    0x20  /* The door is closed */
+#define UI_EVENT_STATUS        0x40  /* The Control_ECU sent the provisioning status */
+
+/* Events of the LCD task */
+#define LCD_EVENT_STEP         0x01  /* Time to send the next byte of the screen changes */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/* Screens of the HMI, each one waits for its events without blocking */
+typedef enum
+{
+	UI_BOOT ,
+	UI_SETUP_ENTER , UI_SETUP_REENTER , UI_SETUP_VERDICT ,
+	UI_MENU ,
+	UI_OPEN_ENTER , UI_OPEN_VERDICT , UI_DOOR_CYCLE ,
+	UI_CHANGE_OLD , UI_CHANGE_NEW , UI_CHANGE_VERDICT ,
+	UI_MESSAGE , UI_DOOR_STOPPED , UI_NO_REPLY , UI_ALARM
+}Ui_State;
 
 /*******************************************************************************
  *                           Global Variables                                  *
  *******************************************************************************/
-/* Global variable to save the number of overflow interrupts of timer0 */
-uint16 g_timer0Ticks = 0;
+
+/* Tasks of the system, each one handles its events and returns without waiting */
+static Scheduler_Task g_linkTask;
+static Scheduler_Task g_uiTask;
+static Scheduler_Task g_lcdTask;
+
+/* Timer to poll the link again when a frame stops in the middle */
+static SwTimer g_linkTimer;
+
+/* Timer to send the next byte of the screen changes */
+static SwTimer g_lcdTimer;
+
+/* Periodic timer to scan the keypad */
+static SwTimer g_keypadTimer;
+
+/*
+ * Timers of the door cycle messages, all armed at the start of the cycle with the time
+ * from the start so the steps don't add errors
+ */
+static SwTimer g_doorOpenTimer;
+static SwTimer g_doorLockingTimer;
+static SwTimer g_doorClosedTimer;
+
+/* Phase and time of the door cycle the Control_ECU starts from, sent with the MATCH verdict of an open request */
+static uint8 g_doorPhase = DOOR_PHASE_UNLOCKING;
+static uint32 g_doorResumeTime = 0;
+
+/* Timer of the short messages and the alarm message */
+static SwTimer g_messageTimer;
+
+/* Screen shown now */
+static Ui_State g_uiState = UI_BOOT;
+
+/*
+ * Password of 5 numbers each in a byte
+ * Array of bytes to the password of 5 numbers followed by the new password when changing it
+ */
+static uint8 g_password[2 * PASSWORD_LENGTH];
+
+/* Number of digits taken from the keypad for the password of this screen */
+static uint8 g_digitsCount = 0;
+
+/* Number of wrong passwords in a row */
+static uint8 g_wrongTrials = 0;
+
+/* Last result of a password check received from the Control_ECU */
+static uint8 g_verdict = MISMATCH;
+
+/* Provisioning status received from the Control_ECU at startup */
+static uint8 g_provisioning = NOT_PROVISIONED;
+
+/* Texts of the screens, kept in the flash so they are not copied to the RAM at startup */
+static const char g_textPleaseEnter[] PROGMEM = "Please Enter";
+static const char g_textPleaseReenter[] PROGMEM = "Please Reenter ";
+static const char g_textEnterNew[] PROGMEM = "Enter New";
+static const char g_textPassword[] PROGMEM = "Password: ";
+static const char g_textMenuOpen[] PROGMEM = " + : Open Door";
+static const char g_textMenuChange[] PROGMEM = " - : Change Password";
+static const char g_textDoorUnlocking[] PROGMEM = "Door unlocking";
+static const char g_textDoorOpen[] PROGMEM = " Door is Open";
+static const char g_textDoorLocking[] PROGMEM = " Door locking";
+static const char g_textDoorStopped[] PROGMEM = " Door stopped";
+static const char g_textWrongPassword[] PROGMEM = " Wrong Password";
+static const char g_textNoReply[] PROGMEM = " No Reply";
+static const char g_textError[] PROGMEM = "   ERROR !!   ";
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -46,90 +158,456 @@ uint16 g_timer0Ticks = 0;
 
 /*
  * Description:
- * Function to be set as the Callback Function for Timer0
- * It counts the number of overflow interrupts
- * Uses a global variable to save the count
+ * Callbacks of the UART and the software timers, they only set the events of the tasks
  */
-void Timer0_interruptCounter(void)
+void Link_notify(void)
+{
+	Scheduler_setEvents(&g_linkTask, LINK_EVENT_RX);
+}
+
+void Link_receive(uint8 a_data)
+{
+	Scheduler_setEvents(&g_linkTask, LINK_EVENT_RX);
+}
+
+void Lcd_notify(void)
+{
+	Scheduler_setEvents(&g_lcdTask, LCD_EVENT_STEP);
+}
+
+void Ui_notifyScan(void)
+{
+	Scheduler_setEvents(&g_uiTask, UI_EVENT_SCAN);
+}
+
+void Ui_notifyTimeout(void)
+{
+	Scheduler_setEvents(&g_uiTask, UI_EVENT_TIMEOUT);
+}
+
+void Ui_notifyDoorOpen(void)
 {
-	/* Increment on every interrupt */
-	g_timer0Ticks++;
+	Scheduler_setEvents(&g_uiTask, UI_EVENT_DOOR_OPEN);
+}
+
+void Ui_notifyDoorLock(void)
+{
+	Scheduler_setEvents(&g_uiTask, UI_EVENT_DOOR_LOCK);
+}
+
+void Ui_notifyDoorClose(void)
+{
+	Scheduler_setEvents(&g_uiTask, UI_EVENT_DOOR_CLOSE);
 }
 
 /*
  * Description:
- * Function to set the initail password for the system
- * It takes the password array of the system as argument
- * Takes values pressed by the keypad stores it in the password array
- * Sends it to the Control_ECU by UART to be saved in eeprom
+ * Task to receive the frames from the Control_ECU
+ * The result of a password check and the provisioning status are saved and given to the UI task
  */
-void Passowrd_init(uint8 *a_password)
+void Link_task(uint8 a_events)
 {
-	/*
-	 * Variable to count the 5 passowrd numbers
-	 * Variable to check the Entered number is 0
-	 */
-	uint8 counter , num_check;
-	LCD_clearScreen();
-	LCD_displayString("Please Enter");
-	LCD_displayStringRowColumn(1, 0, "Password: ");
-
-	/*Loop to get 5 numbers*/
-	for( counter = 0; counter < 5; counter++)
+	Protocol_Frame frame;
+	Protocol_Status status;
+
+	while((status = PROTOCOL_poll(&frame)) != PROTOCOL_FRAME_PENDING)
 	{
-		/* Taking the number from keypad  */
-		num_check = KEYPAD_getPressedKey();
-		if( num_check == 0)
+		if((status == PROTOCOL_FRAME_READY) && (frame.command == VERDICT))
 		{
-			/* Changing the value to send it as string by UART because it has the same value as \0 */
-			num_check = 0xFF;
+			g_verdict = (frame.length >= 1) ? frame.payload[0] : MISMATCH;
+			g_doorPhase = DOOR_PHASE_UNLOCKING;
+			g_doorResumeTime = 0;
+			if(frame.length == VERDICT_DOOR_LENGTH)
+			{
+				g_doorPhase = frame.payload[1];
+				g_doorResumeTime = ((uint32)frame.payload[2] << 8) | frame.payload[3];
+			}
+			Scheduler_setEvents(&g_uiTask, UI_EVENT_VERDICT);
+		}
+		else if((status == PROTOCOL_FRAME_READY) && (frame.command == STATUS) && (frame.length == 1))
+		{
+			g_provisioning = frame.payload[0];
+			Scheduler_setEvents(&g_uiTask, UI_EVENT_STATUS);
 		}
-		/* Saving number in the string*/
-		a_password[counter] = num_check;
-		/*Display the password in the form of ***** */
-		LCD_displayCharacter('*');
-		/* Delay to read the key once every click */
-		_delay_ms(400);
+	}
+	/* Polling again after the timeout only inside a frame so a frame that stops in the middle is dropped */
+	if(PROTOCOL_isReceiving())
+	{
+		SwTimer_start(&g_linkTimer, PROTOCOL_BYTE_TIMEOUT_MS + 1, 0, Link_notify);
+	}
+	else
+	{
+		SwTimer_cancel(&g_linkTimer);
+	}
+}
+
+/*
+ * Description:
+ * Task to send the screen changes to the LCD one byte at a time so the keypad
+ * and the link are not kept waiting while a screen is drawn
+ */
+void Lcd_task(uint8 a_events)
+{
+	if(LCD_frameStep())
+	{
+		SwTimer_start(&g_lcdTimer, LCD_STEP_PERIOD_MS, 0, Lcd_notify);
+	}
+}
 
+/*
+ * Description:
+ * Function to show a screen of two rows from the texts in the flash, NULL_PTR for an
+ * empty row. Only the characters that are different from the screen shown now are
+ * sent to the LCD by the LCD task
+ */
+void Ui_show(const char *a_row0, const char *a_row1)
+{
+	LCD_frameClear();
+	LCD_frameString_P(0, 0, a_row0);
+	if(a_row1 != NULL_PTR)
+	{
+		LCD_frameString_P(1, 0, a_row1);
 	}
+	Scheduler_setEvents(&g_lcdTask, LCD_EVENT_STEP);
+}
 
-	a_password[5] = '#' ; /*Char for UART sending string Protocol */
-	a_password[6] = '\0' ;  /*NULL operator for end of string in memory*/
-	UART_sendString(a_password); /*Sending password to the control micro to save it in eeprom*/
+/*
+ * Description:
+ * Function to show the screen of the state and start waiting for its events
+ */
+void Ui_enter(Ui_State a_state)
+{
+	/* Start time of the door cycle on the HMI_ECU timers */
+	uint32 cycle_start;
 
+	g_uiState = a_state;
+	g_digitsCount = 0;
+
+	switch(a_state)
+	{
+	case UI_BOOT:
+		/* Asking the Control_ECU if the system has a password, again until it replies */
+		PROTOCOL_sendFrame(GET_STATUS, NULL_PTR, 0);
+		SwTimer_start(&g_messageTimer, STATUS_RETRY_MS, 0, Ui_notifyTimeout);
+		break;
+	case UI_SETUP_ENTER:
+	case UI_OPEN_ENTER:
+	case UI_CHANGE_OLD:
+		Ui_show(g_textPleaseEnter, g_textPassword);
+		break;
+	case UI_SETUP_REENTER:
+		Ui_show(g_textPleaseReenter, g_textPassword);
+		break;
+	case UI_CHANGE_NEW:
+		Ui_show(g_textEnterNew, g_textPassword);
+		break;
+	case UI_MENU:
+		/*Displaying options*/
+		Ui_show(g_textMenuOpen, g_textMenuChange);
+		break;
+	case UI_DOOR_CYCLE:
+		/*
+		 * Control MC starts the motor when it sends MATCH so the countdown starts now,
+		 * from the phase and the time of the cycle it sent with the verdict
+		 */
+		if(g_doorPhase == DOOR_PHASE_OPEN)
+		{
+			Ui_show(g_textDoorOpen, NULL_PTR);
+		}
+		else
+		{
+			Ui_show(g_textDoorUnlocking, NULL_PTR);
+		}
+		cycle_start = SysTime_millis() - g_doorResumeTime;
+		/* Door is open after 15 sec, stays 3 sec then it is locked in 15 sec, the passed steps fire at once */
+		SwTimer_startAt(&g_doorOpenTimer, SysTime_deadline(cycle_start, DOOR_UNLOCKING_MS), 0, Ui_notifyDoorOpen);
+		SwTimer_startAt(&g_doorLockingTimer, SysTime_deadline(cycle_start, DOOR_UNLOCKING_MS + DOOR_OPEN_MS), 0, Ui_notifyDoorLock);
+		SwTimer_startAt(&g_doorClosedTimer, SysTime_deadline(cycle_start, DOOR_UNLOCKING_MS + DOOR_OPEN_MS + DOOR_LOCKING_MS), 0, Ui_notifyDoorClose);
+		break;
+	case UI_MESSAGE:
+		Ui_show(g_textWrongPassword, NULL_PTR);
+		SwTimer_start(&g_messageTimer, MESSAGE_MS, 0, Ui_notifyTimeout);
+		break;
+	case UI_DOOR_STOPPED:
+		Ui_show(g_textDoorStopped, NULL_PTR);
+		SwTimer_start(&g_messageTimer, MESSAGE_MS, 0, Ui_notifyTimeout);
+		break;
+	case UI_SETUP_VERDICT:
+	case UI_OPEN_VERDICT:
+	case UI_CHANGE_VERDICT:
+		/* Waiting for the Control_ECU, the screen is not changed until the result or the timeout */
+		SwTimer_start(&g_messageTimer, VERDICT_TIMEOUT_MS, 0, Ui_notifyTimeout);
+		break;
+	case UI_NO_REPLY:
+		Ui_show(g_textNoReply, NULL_PTR);
+		SwTimer_start(&g_messageTimer, MESSAGE_MS, 0, Ui_notifyTimeout);
+		break;
+	case UI_ALARM:
+		/* Sending command to controller micro to trigger buzzer */
+		PROTOCOL_sendFrame(TRIGGER, NULL_PTR, 0);
+		Ui_show(g_textError, NULL_PTR);
+		/* Showing the error for 1 min */
+		SwTimer_start(&g_messageTimer, ALARM_MS, 0, Ui_notifyTimeout);
+		break;
+	default:
+		break;
+	}
 }
 
 /*
  * Description:
- * Function to take password from keypad pressed keys
- * It takes the password array of the system as argument
- * Saves the pressed password in the argument array
- * Send password to Control_ECU to compare it with the saved one in eeprom
+ * Function to take a password digit pressed on the keypad
+ * The digit is saved at the offset in the password array and shown as *
+ * Returns TRUE when all the digits of the password are taken
  */
-void TakeSend_Password(uint8 * a_password)
+boolean Take_Digit(uint8 a_key, uint8 a_offset)
 {
-	uint8 num_check;/* Variable to check the Entered number is 0 */
-	/*Loop to get 5 numbers*/
-	for(uint8 counter = 0; counter < 5; counter++)
+	g_password[a_offset + g_digitsCount] = a_key;
+#if (STREAM_PASSWORD_DIGITS == TRUE)
+	if((g_uiState == UI_OPEN_ENTER) || (g_uiState == UI_CHANGE_OLD))
 	{
-		/* Taking the number from keypad  */
-		num_check = KEYPAD_getPressedKey();
-		if( num_check == 0)
+		/* Position and value of the digit */
+		uint8 digit[2] = {g_digitsCount, a_key};
+		PROTOCOL_sendFrame(DIGIT, digit, 2);
+	}
+#endif
+	/*Display the password in the form of ***** */
+	LCD_frameString_P(1, PASSWORD_COLUMN + g_digitsCount, PSTR("*"));
+	Scheduler_setEvents(&g_lcdTask, LCD_EVENT_STEP);
+	g_digitsCount++;
+	return (g_digitsCount == PASSWORD_LENGTH);
+}
+
+/*
+ * Description:
+ * Function to tell if the screen shown now takes keys, the keys pressed while
+ * waiting for the Control_ECU or a message are kept for the next screen
+ */
+boolean Ui_takesKeys(void)
+{
+	switch(g_uiState)
+	{
+	case UI_BOOT:
+	case UI_SETUP_VERDICT:
+	case UI_OPEN_VERDICT:
+	case UI_CHANGE_VERDICT:
+	case UI_MESSAGE:
+	case UI_DOOR_STOPPED:
+	case UI_NO_REPLY:
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+/*
+ * Description:
+ * Function to handle a pressed key or KEYPAD_NO_KEY with the events of the screen shown now
+ */
+void Ui_handle(uint8 a_key, uint8 a_events)
+{
+	switch(g_uiState)
+	{
+	case UI_BOOT:
+		if(a_events & UI_EVENT_STATUS)
+		{
+			SwTimer_cancel(&g_messageTimer);
+			/* A system with a password goes to the menu at once */
+			Ui_enter((g_provisioning == PROVISIONED) ? UI_MENU : UI_SETUP_ENTER);
+		}
+		else if(a_events & UI_EVENT_TIMEOUT)
+		{
+			Ui_enter(UI_BOOT);
+		}
+		break;
+	case UI_SETUP_ENTER:
+		if((a_key != KEYPAD_NO_KEY) && Take_Digit(a_key, 0))
+		{
+			/*Sending password to the control micro to save it in eeprom*/
+			PROTOCOL_sendFrame(PASSWORD, g_password, PASSWORD_LENGTH);
+			Ui_enter(UI_SETUP_REENTER);
+		}
+		break;
+	case UI_SETUP_REENTER:
+		if((a_key != KEYPAD_NO_KEY) && Take_Digit(a_key, 0))
+		{
+			PROTOCOL_sendFrame(PASSWORD, g_password, PASSWORD_LENGTH);
+			Ui_enter(UI_SETUP_VERDICT);
+		}
+		break;
+	case UI_SETUP_VERDICT:
+		if(a_events & UI_EVENT_VERDICT)
+		{
+			SwTimer_cancel(&g_messageTimer);
+			/*
+			 * In case of mismatch of password the password
+			 * must be cleared and new password to be saved
+			 */
+			Ui_enter((g_verdict == MATCH) ? UI_MENU : UI_SETUP_ENTER);
+		}
+		else if(a_events & UI_EVENT_TIMEOUT)
+		{
+			Ui_enter(UI_NO_REPLY);
+		}
+		break;
+	case UI_MENU:
+		if(a_key == '+')/* Open Door */
+		{
+			Ui_enter(UI_OPEN_ENTER);
+		}
+		else if(a_key == '-') /*  change password */
 		{
-			/* Changing the value to send it as string by UART because it has the same value as \0 */
-			num_check = 0xFF;
+			Ui_enter(UI_CHANGE_OLD);
 		}
-		/* Saving number in the string*/
-		a_password[counter] = num_check;
-		LCD_displayCharacter('*');/*Display the password in the form of ***** */
-		_delay_ms(400);
+		break;
+	case UI_OPEN_ENTER:
+		if((a_key != KEYPAD_NO_KEY) && Take_Digit(a_key, 0))
+		{
+			/* Sending Door open request with the password to control micro */
+#if (STREAM_PASSWORD_DIGITS == TRUE)
+			PROTOCOL_sendFrame(OPENDOOR, NULL_PTR, 0);
+#else
+			PROTOCOL_sendFrame(OPENDOOR, g_password, PASSWORD_LENGTH);
+#endif
+			Ui_enter(UI_OPEN_VERDICT);
+		}
+		break;
+	case UI_CHANGE_OLD:
+		if((a_key != KEYPAD_NO_KEY) && Take_Digit(a_key, 0))
+		{
+			/* Taking new passowrd after the old one */
+			Ui_enter(UI_CHANGE_NEW);
+		}
+		break;
+	case UI_CHANGE_NEW:
+		if((a_key != KEYPAD_NO_KEY) && Take_Digit(a_key, PASSWORD_LENGTH))
+		{
+			/* Sending to Controller micro pass change request with the old and new passwords */
+#if (STREAM_PASSWORD_DIGITS == TRUE)
+			/* The old password was streamed */
+			PROTOCOL_sendFrame(CHANGEPASS, g_password + PASSWORD_LENGTH, PASSWORD_LENGTH);
+#else
+			PROTOCOL_sendFrame(CHANGEPASS, g_password, 2 * PASSWORD_LENGTH);
+#endif
+			Ui_enter(UI_CHANGE_VERDICT);
+		}
+		break;
+	case UI_OPEN_VERDICT:
+	case UI_CHANGE_VERDICT:
+		if(a_events & UI_EVENT_VERDICT)
+		{
+			SwTimer_cancel(&g_messageTimer);
+			if(g_verdict == MATCH)
+			{
+				/* Clearing wrong trials because the password was right before 3rd trial */
+				g_wrongTrials = 0;
+				Ui_enter((g_uiState == UI_OPEN_VERDICT) ? UI_DOOR_CYCLE : UI_MENU);
+			}
+			else
+			{
+				/* Increment wrong trials*/
+				g_wrongTrials++;
+				Ui_enter(UI_MESSAGE);
+			}
+		}
+		else if(a_events & UI_EVENT_TIMEOUT)
+		{
+			Ui_enter(UI_NO_REPLY);
+		}
+		break;
+	case UI_DOOR_CYCLE:
+		if(a_key == DOOR_STOP_KEY)
+		{
+			/* The Control_ECU stops the motor as soon as the request is received */
+			PROTOCOL_sendFrame(DOOR_STOP, NULL_PTR, 0);
+			SwTimer_cancel(&g_doorOpenTimer);
+			SwTimer_cancel(&g_doorLockingTimer);
+			SwTimer_cancel(&g_doorClosedTimer);
+			Ui_enter(UI_DOOR_STOPPED);
+			break;
+		}
+		if(a_events & UI_EVENT_DOOR_OPEN)
+		{
+			Ui_show(g_textDoorOpen, NULL_PTR);
+		}
+		if(a_events & UI_EVENT_DOOR_LOCK)
+		{
+			Ui_show(g_textDoorLocking, NULL_PTR);
+		}
+		if(a_events & UI_EVENT_DOOR_CLOSE)
+		{
+			Ui_enter(UI_MENU);
+		}
+		break;
+	case UI_MESSAGE:
+		if(a_events & UI_EVENT_TIMEOUT)
+		{
+			Ui_enter((g_wrongTrials == MAX_WRONG_TRIALS) ? UI_ALARM : UI_MENU);
+		}
+		break;
+	case UI_DOOR_STOPPED:
+		if(a_events & UI_EVENT_TIMEOUT)
+		{
+			Ui_enter(UI_MENU);
+		}
+		break;
+	case UI_NO_REPLY:
+		if(a_events & UI_EVENT_TIMEOUT)
+		{
+			/*
+			 * The request or its result was lost, or the Control_ECU restarted. Sending the
+			 * request again is not safe (a streamed password is used once and a new password
+			 * may be saved already) so the status is asked again like at startup, this also
+			 * makes the Control_ECU start a cut setting of the first password again
+			 */
+			Ui_enter(UI_BOOT);
+		}
+		break;
+	case UI_ALARM:
+		if(a_events & UI_EVENT_TIMEOUT)
+		{
+			/* Clearing wrong trials to restart the system */
+			g_wrongTrials = 0;
+			Ui_enter(UI_MENU);
+		}
+		break;
 	}
+}
 
+/*
+ * Description:
+ * Task of the user interface, handles the results from the Control_ECU, the timed
+ * messages and the keys typed on the keypad in order
+ */
+void Ui_task(uint8 a_events)
+{
+	Keypad_Event event;
 
-	a_password[5] = '#' ; /* Char for UART sending string Protocol */
-	a_password[6] = '\0' ;  /* NULL operator for end of string in memory*/
-	UART_sendString(a_password); /* Sending password to the control micro to save it in eeprom*/
+	if(a_events & UI_EVENT_SCAN)
+	{
+		KEYPAD_tick();
+#if (KEYPAD_WAKE_INTERRUPT != KEYPAD_WAKE_NONE)
+		/* Scanning until all the keys are released, then waiting for the next press without scanning */
+		if(KEYPAD_isIdle() && KEYPAD_enableWake())
+		{
+			SwTimer_cancel(&g_keypadTimer);
+		}
+		else if(!SwTimer_isArmed(&g_keypadTimer))
+		{
+			SwTimer_start(&g_keypadTimer, KEYPAD_SCAN_PERIOD_MS, KEYPAD_SCAN_PERIOD_MS, Ui_notifyScan);
+		}
+#endif
+	}
+	Ui_handle(KEYPAD_NO_KEY, a_events & (uint8)~UI_EVENT_SCAN);
 
+	/* A key can change the screen so the keys are taken one by one while the screen takes them */
+	while(Ui_takesKeys() && KEYPAD_getEvent(&event))
+	{
+		if(event.type == KEYPAD_KEY_PRESSED)
+		{
+			Ui_handle(event.key, 0);
+		}
+	}
 }
 
 /*******************************************************************************
@@ -140,147 +618,31 @@ void TakeSend_Password(uint8 * a_password)
 void main(void)
 {
 
-	/* Struct to configer UART with Baud rate = 9600 bps and one stop bit*/
-	Uart_ConfigType Config_Uart = { 9600 , ONE_STOP_BIT };
-	/* Struct ti configer Timer 0 in overflow mode with prescaler 1024 and initial value = 0*/
-	Timer0_ConfigType Config_Timer0 = {NORMAL , F_CPU_1024 , 0  , 255};
+	/* Struct to configer UART with Baud rate = 9600 bps, one stop bit and interrupt driven buffers */
+	Uart_ConfigType Config_Uart = { 9600 , ONE_STOP_BIT , UART_BUFFERED };
 
 	/* Initializing Drivers*/
 	LCD_init(); /* Initializing LCD */
 	UART_init(&Config_Uart); /* Initializing UART */
-	/* Setting Callback Function for Timer 0 */
-	Timer0_setCallBack(Timer0_interruptCounter, NORMAL);
-	/* Variable to Save the chosen option
-	 * Variable to count wrong trials
-	 */
-	uint8 option , wrong_trials = 0;
-	/* Password of 5 numbers each in a byte
-	 * Array of bytes to the password of 5 numbers
-	 * Char for UART sending string and Null operator
-	 */
-	uint8 password[7] = {0} , receive_password_msg = MISMATCH; /* Initially mismatch to enter the loop 1st time*/
-	/* In case of mismatch of password the password
-	 * must be cleared and new password to be saved*/
-	/* To exit the loop the two passwords must be exact*/
-	while( receive_password_msg == MISMATCH)
-	{
-		/* Initializing passowrd and sending it to be saved in eeprom*/
-		Passowrd_init(password);
-		LCD_clearScreen();
-		LCD_displayString("Please Reenter ");
-		LCD_displayStringRowColumn(1, 0, "Password: ");
-		TakeSend_Password(password);
-		/* Control micro send messege after compering the reentered password*/
-		receive_password_msg = UART_recieveByte();
-	}
+	SysTime_init(); /* Initializing the 1 ms system time */
+	SwTimer_init(); /* Initializing the software timers of the keypad and the messages */
 
-	while(1)
-	{
-
-		/*Displaying options*/
-		LCD_clearScreen();
-		LCD_displayString(" + : Open Door");
-		LCD_displayStringRowColumn(1, 0, " - : Change Password");
-		/*
-		 * First saving the option in the variable
-		 * keep getting the value of the pressed key until it is the right choice
-		 */
-		option = KEYPAD_getPressedKey();
-		_delay_ms(500);
+	/* Creating the tasks */
+	Scheduler_createTask(&g_linkTask, Link_task);
+	Scheduler_createTask(&g_uiTask, Ui_task);
+	Scheduler_createTask(&g_lcdTask, Lcd_task);
 
-		if(option == '+')/* Open Door */
-		{
+	/* Every received byte wakes up the link task */
+	UART_setRxCallBack(Link_receive);
+	/* Scanning the keypad in the background, a key press wakes up the scan with the wake profile */
+#if (KEYPAD_WAKE_INTERRUPT != KEYPAD_WAKE_NONE)
+	KEYPAD_setWakeCallBack(Ui_notifyScan);
+#endif
+	SwTimer_start(&g_keypadTimer, KEYPAD_SCAN_PERIOD_MS, KEYPAD_SCAN_PERIOD_MS, Ui_notifyScan);
 
-			/* Sending Door open request to control micro */
-			UART_sendByte(OPENDOOR);
-			LCD_clearScreen();
-			LCD_displayString("Please Enter ");
-			LCD_displayStringRowColumn(1, 0, "Password: ");
-			TakeSend_Password(password);/* Taking password and sending it to check if it's correct */
-			/* Control micro send messege after compering the password with saved one */
-			receive_password_msg = UART_recieveByte();
-			if(receive_password_msg == MISMATCH)
-			{
-				LCD_clearScreen();
-				LCD_displayString(" Wrong Password");
-				_delay_ms(1000);
-				LCD_clearScreen();
-				/* Increment wrong trials*/
-				wrong_trials++;
-			}
-			else if(receive_password_msg == MATCH)
-			{
-				/* Wait for Control MC to be ready to start and send ready messege */
-				UART_sendByte(READY);
-				UART_recieveByte();
-				/* Initializing Timer to count the time for openning and closing the door*/
-				Timer0_init(&Config_Timer0);
-				LCD_clearScreen();
-				g_timer0Ticks = 0;
-				LCD_displayString("Door unlocking");
-				/* wait 15 sec till the door is open */
-				while(g_timer0Ticks < SEC_15);
-				/* Start count for 3 sec */
-				LCD_clearScreen();
-				LCD_displayString(" Door is Open");
-				/* Waiting 3 sec */
-				while( g_timer0Ticks < SEC_18);
-				/* Start count for 15 sec */
-				LCD_clearScreen();
-				LCD_displayString(" Door locking");
-				while( g_timer0Ticks < SEC_33);
-				/* Stopping Timer to reset it */
-				Timer0_DeInit();
-				g_timer0Ticks = 0;
-				/* Clearing wrong trials because the password was right before 3rd trial */
-				wrong_trials = 0;
-			}
-		}
-		else if(option == '-') /*  change password */
-		{
-			/* Sending to Controller micro pass change request */
-			UART_sendByte(CHANGEPASS);
-			LCD_clearScreen();
-			LCD_displayString("Please Enter ");
-			LCD_displayStringRowColumn(1, 0, "Password: ");
-			TakeSend_Password(password); /* Comparing it to the saved password */
-			/* Control micro send messege after compering the reentered password*/
-			receive_password_msg = UART_recieveByte();
-			if(receive_password_msg == MISMATCH)
-			{
-				LCD_clearScreen();
-				LCD_displayString(" Wrong Password");
-				_delay_ms(1000);
-				LCD_clearScreen();
-				/* Incrementing wrong trials */
-				wrong_trials++;
-			}
-			else if (receive_password_msg == MATCH)
-			{
-				LCD_clearScreen();
-				LCD_displayString("Enter New");
-				LCD_displayStringRowColumn(1, 0, "Password: ");
-				/* Taking passowrd and sending it to be saved in eeprom*/
-				TakeSend_Password(password);
-				/* Clearing wrong trials because the password was right before 3rd trial */
-				wrong_trials = 0;
-			}
-		}
-		if(wrong_trials == 3)
-		{
-			/* Sending request to controller micro to trigger buzzer */
-			UART_sendByte(TRIGGER); /* Sending command to controller micro to trigger buzzer */
-			LCD_clearScreen();
-			LCD_displayString("   ERROR !!   ");
-			/* Timer count 1 min */
-			Timer0_init(&Config_Timer0);
-			while(g_timer0Ticks < MINUTE);
-			/* Stopping Timer to reset it */
-			Timer0_DeInit();
-			g_timer0Ticks = 0;
-			/* Clearing wrong trials to restart the system */
-			wrong_trials = 0;
-		}
+	/* Asking the Control_ECU if the first password of the system must be set */
+	Ui_enter(UI_BOOT);
 
-	}
+	/* Running the tasks, never returns */
+	Scheduler_start();
 }
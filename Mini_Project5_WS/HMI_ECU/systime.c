@@ -0,0 +1,186 @@
+ /******************************************************************************
+ *
+ * Module: System Time
+ *
+ * File Name: systime.c
+ *
+ * Description: Source file for the millisecond system clock based on Timer0
+ *
+ * Author: Mustafa Esam
+ *
+ *******************************************************************************/
+
+#include "systime.h"
+#include "timer0.h"
+#include "common_macros.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Milliseconds since SysTime_init, incremented by the Timer0 compare interrupt */
+static volatile uint32 g_millis = 0;
+
+/* Part of the next ms that passed in units of one F_CPU/64 count, kept when the tick is changed */
+static uint8 g_millisFraction = 0;
+
+/* TRUE while the CPU sleeps with the slow tick, the tick interrupt only wakes it then */
+static volatile boolean g_sleeping = FALSE;
+static volatile boolean g_sleepExpired = FALSE;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Callback of the Timer0 compare interrupt, called every 1 ms.
+ */
+static void SysTime_tick(void)
+{
+	if(g_sleeping)
+	{
+		/* The time slept is added by SysTime_idle after the wake up */
+		g_sleepExpired = TRUE;
+	}
+	else
+	{
+		g_millis++;
+	}
+}
+
+/*
+ * Description :
+ * Start Timer0 in CTC mode with a 1 ms tick and clear the time.
+ */
+void SysTime_init(void)
+{
+	/* Struct to configer Timer 0 in compare mode with prescaler 64 and compare value for 1 ms */
+	Timer0_ConfigType Config_Timer0 = {CTC , F_CPU_64 , 0 , SYSTIME_OCR0_VALUE};
+
+	g_millis = 0;
+	Timer0_setCallBack(SysTime_tick, CTC);
+	Timer0_init(&Config_Timer0);
+}
+
+/*
+ * Description :
+ * Sleep in Idle mode with the slow tick until the deadline or any interrupt, then go back
+ * to the 1 ms tick with the time slept added. The time doesn't advance for the interrupts
+ * that run while the CPU sleeps.
+ * Must be called with the interrupts disabled after checking there is nothing to do,
+ * the interrupts are enabled when it returns.
+ */
+void SysTime_idle(uint32 deadline)
+{
+	uint32 remaining;
+	uint16 units;
+	uint16 counts;
+
+	/* Stopping the 1 ms tick and keeping the part of the ms that passed */
+	TCCR0 = (1<<FOC0) | (1<<WGM01);
+	if(BIT_IS_SET(TIFR, OCF0))
+	{
+		/* The tick was due while the interrupts were disabled */
+		g_millis++;
+	}
+	TIFR = (1<<OCF0);
+	units = (uint16)g_millisFraction + TCNT0;
+	g_millis += units / SYSTIME_UNITS_PER_MS;
+	g_millisFraction = units % SYSTIME_UNITS_PER_MS;
+
+	remaining = deadline - g_millis;
+	if((sint32)remaining > 0)
+	{
+		if(remaining > SYSTIME_IDLE_MAX_MS)
+		{
+			remaining = SYSTIME_IDLE_MAX_MS;
+		}
+
+		/* Slow tick interrupt at the deadline, the counts are rounded up so it is never early */
+		units = ((uint16)remaining * SYSTIME_UNITS_PER_MS) - g_millisFraction;
+		counts = (units + SYSTIME_UNITS_PER_COUNT - 1) / SYSTIME_UNITS_PER_COUNT;
+		g_sleepExpired = FALSE;
+		g_sleeping = TRUE;
+		TCNT0 = 0;
+		OCR0 = (uint8)(counts - 1);
+		TCCR0 = (1<<FOC0) | (1<<WGM01) | F_CPU_1024;
+
+		/* The instruction after sei is done before any interrupt so a pending one wakes the CPU at once */
+		set_sleep_mode(SLEEP_MODE_IDLE);
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+
+		/* Woken up, adding the time slept */
+		cli();
+		TCCR0 = (1<<FOC0) | (1<<WGM01);
+		counts = TCNT0;
+		if(g_sleepExpired || BIT_IS_SET(TIFR, OCF0))
+		{
+			counts += (uint16)OCR0 + 1;
+		}
+		TIFR = (1<<OCF0);
+		g_sleeping = FALSE;
+
+		units = (counts * SYSTIME_UNITS_PER_COUNT) + g_millisFraction;
+		g_millis += units / SYSTIME_UNITS_PER_MS;
+		g_millisFraction = units % SYSTIME_UNITS_PER_MS;
+	}
+
+	/* Going back to the 1 ms tick */
+	TCNT0 = 0;
+	OCR0 = SYSTIME_OCR0_VALUE;
+	TCCR0 = (1<<FOC0) | (1<<WGM01) | F_CPU_64;
+	sei();
+}
+
+/*
+ * Description :
+ * Return the milliseconds since SysTime_init, read atomically against the tick interrupt.
+ * It wraps after about 49 days, the deadline functions take care of the wrap.
+ */
+uint32 SysTime_millis(void)
+{
+	uint32 millis;
+	uint8 sreg = SREG;
+
+	/* The 4 bytes can't be read in one instruction so the tick must not change them meanwhile */
+	cli();
+	millis = g_millis;
+	SREG = sreg;
+
+	return millis;
+}
+
+/*
+ * Description :
+ * Return the time duration_ms milliseconds after the time start.
+ */
+uint32 SysTime_deadline(uint32 start, uint32 duration_ms)
+{
+	return start + duration_ms;
+}
+
+/*
+ * Description :
+ * Return TRUE if the deadline is reached.
+ */
+boolean SysTime_isExpired(uint32 deadline)
+{
+	/* Signed difference so the wrap of the time doesn't matter */
+	return ((sint32)(SysTime_millis() - deadline) >= 0);
+}
+
+/*
+ * Description :
+ * Wait until the deadline is reached.
+ */
+void SysTime_waitUntil(uint32 deadline)
+{
+	while(!SysTime_isExpired(deadline));
+}
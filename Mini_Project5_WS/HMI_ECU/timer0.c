@@ -63,7 +63,7 @@ void Timer0_init(Timer0_ConfigType *Config_PTR)
 	 * CTC mode:      WGM00 = 0 , WGM01 = 1
 	 * Fast PWM mode: WGM00 = 1 , WGM01 = 1
 	 **************************************************************************************/
-	TCCR0 = (((Config_PTR->mode >> 1) << WGM01) & 1) | ((Config_PTR->mode & 1) << WGM00);
+	TCCR0 = (((Config_PTR->mode >> 1) & 1) << WGM01) | ((Config_PTR->mode & 1) << WGM00);
 	/* Non PWM mode FOC0=1*/
 	TCCR0 |= (1<<FOC0);
 
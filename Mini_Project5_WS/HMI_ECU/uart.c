@@ -12,7 +12,76 @@
 
 #include "uart.h"
 #include "avr/io.h" /* To use the UART Registers */
+#include <avr/interrupt.h> /* For the USART ISRs */
 #include "common_macros.h" /* To use the macros like SET_BIT */
+#include "systime.h" /* To time the received bytes */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* The mode selected in UART_init */
+static Uart_Mode g_uartMode = UART_POLLING;
+
+/*
+ * Ring buffers for the buffered mode.
+ * The heads are written by the producer and the tails by the consumer only,
+ * the indices are free running and masked by the buffer size on access.
+ */
+static volatile uint8 g_rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0;
+static volatile uint8 g_rxTail = 0;
+
+/* Low 16 bits of SysTime_millis when each byte of the Rx buffer was received */
+static volatile uint16 g_rxTime[UART_RX_BUFFER_SIZE];
+
+static volatile uint8 g_txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint8 g_txHead = 0;
+static volatile uint8 g_txTail = 0;
+
+/* Called from the Rx interrupt after a byte is received in buffered mode */
+static void (*volatile g_rxCallBackPtr)(uint8 data) = NULL_PTR;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/* Interrupt Service Routine for USART Rx Complete */
+ISR(USART_RXC_vect)
+{
+	/* Reading UDR clears the RXC flag so it must be read even if the buffer is full */
+	uint8 data = UDR;
+
+	if((uint8)(g_rxHead - g_rxTail) < UART_RX_BUFFER_SIZE)
+	{
+		g_rxBuffer[g_rxHead & (UART_RX_BUFFER_SIZE - 1)] = data;
+		g_rxTime[g_rxHead & (UART_RX_BUFFER_SIZE - 1)] = (uint16)SysTime_millis();
+		g_rxHead++;
+	}
+	/* Else: the buffer is full and the byte is dropped */
+
+	if(g_rxCallBackPtr != NULL_PTR)
+	{
+		/* Call the Call Back function in the application with the received byte */
+		(*g_rxCallBackPtr)(data);
+	}
+}
+
+/* Interrupt Service Routine for USART Data Register Empty */
+ISR(USART_UDRE_vect)
+{
+	if(g_txHead != g_txTail)
+	{
+		/* Send the next byte in the Tx buffer */
+		UDR = g_txBuffer[g_txTail & (UART_TX_BUFFER_SIZE - 1)];
+		g_txTail++;
+	}
+	else
+	{
+		/* Nothing left to send, disable the interrupt until a new byte is queued */
+		CLEAR_BIT(UCSRB , UDRIE);
+	}
+}
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -68,6 +137,22 @@ void UART_init(Uart_ConfigType * ConfigType_PTR)
 	/* First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH*/
 	UBRRH = ubrr_value>>8;
 	UBRRL = ubrr_value;
+
+	g_uartMode = ConfigType_PTR->mode;
+	if(g_uartMode == UART_BUFFERED)
+	{
+		/* Start with empty buffers */
+		g_rxHead = 0;
+		g_rxTail = 0;
+		g_txHead = 0;
+		g_txTail = 0;
+
+		/* Enable the Rx Complete Interrupt, UDRIE is enabled only when there is data to send */
+		SET_BIT(UCSRB , RXCIE);
+
+		/*Enable Globel Interrupt*/
+		SREG|=(1<<7);
+	}
 }
 
 /*
@@ -76,6 +161,13 @@ void UART_init(Uart_ConfigType * ConfigType_PTR)
  */
 void UART_sendByte(const uint8 data)
 {
+	if(g_uartMode == UART_BUFFERED)
+	{
+		/* Wait only until there is a free place in the Tx buffer */
+		while(!UART_enqueue(data)){}
+		return;
+	}
+
 	/*
 	 * UDRE flag is set when the Tx buffer (UDR) is empty and ready for
 	 * transmitting a new byte so wait until this flag is set to one
@@ -101,6 +193,15 @@ void UART_sendByte(const uint8 data)
  */
 uint8 UART_recieveByte(void)
 {
+	uint8 data;
+
+	if(g_uartMode == UART_BUFFERED)
+	{
+		/* Wait only until there is a byte in the Rx buffer */
+		while(!UART_tryReceive(&data)){}
+		return data;
+	}
+
 	/* RXC flag is set when the UART receive data so wait until this flag is set to one */
 	while(BIT_IS_CLEAR(UCSRA,RXC)){}
 
@@ -111,6 +212,107 @@ uint8 UART_recieveByte(void)
 	return UDR;
 }
 
+/*
+ * Description :
+ * Put a byte in the Tx buffer without waiting (buffered mode only).
+ * Returns TRUE if the byte was queued or FALSE if the Tx buffer is full.
+ * In polling mode the byte is written directly if UDR is empty.
+ */
+boolean UART_enqueue(const uint8 data)
+{
+	if(g_uartMode != UART_BUFFERED)
+	{
+		if(BIT_IS_CLEAR(UCSRA,UDRE))
+		{
+			return FALSE;
+		}
+		UDR = data;
+		return TRUE;
+	}
+
+	if((uint8)(g_txHead - g_txTail) >= UART_TX_BUFFER_SIZE)
+	{
+		/* Tx buffer is full */
+		return FALSE;
+	}
+
+	g_txBuffer[g_txHead & (UART_TX_BUFFER_SIZE - 1)] = data;
+	g_txHead++;
+
+	/* Let the UDRE interrupt send it */
+	SET_BIT(UCSRB , UDRIE);
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Take a received byte without waiting.
+ * Returns TRUE and saves the byte in data if one was available, FALSE otherwise.
+ */
+boolean UART_tryReceive(uint8 *data)
+{
+	if(g_uartMode != UART_BUFFERED)
+	{
+		if(BIT_IS_CLEAR(UCSRA,RXC))
+		{
+			return FALSE;
+		}
+		*data = UDR;
+		return TRUE;
+	}
+
+	if(g_rxHead == g_rxTail)
+	{
+		/* Rx buffer is empty */
+		return FALSE;
+	}
+
+	*data = g_rxBuffer[g_rxTail & (UART_RX_BUFFER_SIZE - 1)];
+	g_rxTail++;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Same as UART_tryReceive and also saves in time_ms the low 16 bits of SysTime_millis
+ * when the byte was received, taken in the Rx interrupt in buffered mode so a byte
+ * read late keeps its real time. In polling mode it is the time the byte is read.
+ */
+boolean UART_tryReceiveTimed(uint8 *data, uint16 *time_ms)
+{
+	if(g_uartMode != UART_BUFFERED)
+	{
+		*time_ms = (uint16)SysTime_millis();
+		return UART_tryReceive(data);
+	}
+
+	if(g_rxHead == g_rxTail)
+	{
+		/* Rx buffer is empty */
+		return FALSE;
+	}
+
+	/* Only the Rx interrupt adds bytes so the byte at the tail is the one taken */
+	*time_ms = g_rxTime[g_rxTail & (UART_RX_BUFFER_SIZE - 1)];
+	return UART_tryReceive(data);
+}
+
+/*
+ * Description :
+ * Return the number of received bytes waiting to be read.
+ */
+uint8 UART_available(void)
+{
+	if(g_uartMode != UART_BUFFERED)
+	{
+		return BIT_IS_SET(UCSRA,RXC) ? 1 : 0;
+	}
+
+	return (uint8)(g_rxHead - g_rxTail);
+}
+
 /*
  * Description :
  * Send the required string through UART to the other UART device.
@@ -155,3 +357,13 @@ void UART_receiveString(uint8 *Str)
 	/* After receiving the whole string plus the '#', replace the '#' with '\0' */
 	Str[i] = '\0';
 }
+
+/*
+ * Description :
+ * Set the function called from the Rx interrupt with every received byte (buffered mode only).
+ * The byte is in the Rx buffer too, the function runs in interrupt context so it must be short.
+ */
+void UART_setRxCallBack(void(*a_ptr)(uint8 data))
+{
+	g_rxCallBackPtr = a_ptr;
+}